@@ -0,0 +1,71 @@
+#!/bin/sh
+# Runs K solver nodes (4 to 8) as local processes on 127.0.0.1. Node i
+# listens on port BASE+i and sends its tours to node i+1 (a ring), each one
+# in its own directory. The result of every node, the best one and the
+# number of tours received and sent as deltas are shown.
+#
+#   usage: sh localnet.sh [K] [instance] [param_name param_value]...
+#   e.g.   sh localnet.sh 4 a280.tsp timelim 10
+#
+# The environment variables TSP (the program, default ./tsp) and BASE (the
+# first port, default 47000) can be changed. The exit status is 1 if a node
+# fails or if no node has received a valid tour.
+
+K=${1:-4}
+F=${2:-a280.tsp}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] && shift
+TSP=${TSP:-./tsp}
+BASE=${BASE:-47000}
+
+case $TSP in /*) ;; *) TSP=$(pwd)/$TSP ;; esac
+case $F in /*) ;; *) F=$(pwd)/$F ;; esac
+case $K in ''|*[!0-9]*) K=0 ;; esac
+if [ "$K" -lt 4 ] || [ "$K" -gt 8 ] || [ ! -x "$TSP" ] || [ ! -r "$F" ]; then
+  echo "usage: sh localnet.sh [K (4 to 8)] [instance] [param_name param_value]..." >&2
+  exit 1
+fi
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+i=0
+while [ $i -lt "$K" ]; do
+  mkdir "$DIR/$i"
+  (cd "$DIR/$i" &&
+   "$TSP" port $((BASE + i)) peers 127.0.0.1:$((BASE + (i + 1) % K)) debug 1 "$@" \
+     < "$F" > out 2>&1; echo $? > status) &
+  i=$((i + 1))
+done
+wait
+
+status=0
+best=
+received=0
+deltas=0
+i=0
+while [ $i -lt "$K" ]; do
+  len=$(sed -n 's/^recomputed tour length = //p' "$DIR/$i/out")
+  net=$(sed -n 's/^network: //p' "$DIR/$i/out")
+  if [ "$(cat "$DIR/$i/status")" != 0 ] || [ -z "$len" ]; then
+    echo "node $i: failed"
+    cat "$DIR/$i/out"
+    status=1
+  else
+    echo "node $i: $len ($net)"
+    if [ -z "$best" ] || [ "$len" -lt "$best" ]; then
+      best=$len
+    fi
+    n=$(echo "$net" | sed -n 's/.*, \([0-9]*\) received.*/\1/p')
+    received=$((received + ${n:-0}))
+    n=$(echo "$net" | sed -n 's/.*(\([0-9]*\) as deltas).*/\1/p')
+    deltas=$((deltas + ${n:-0}))
+  fi
+  i=$((i + 1))
+done
+echo "best: $best"
+echo "received: $received tours, sent as deltas: $deltas"
+if [ "$received" -eq 0 ]; then
+  echo "no tour was received"
+  status=1
+fi
+exit $status
@@ -16,12 +16,29 @@
   "timelim" is given and how its value is input from the command line.
 ******************************************************************************/
 
+#define _GNU_SOURCE    /* RUSAGE_THREAD */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
 #include <math.h>
 #include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <errno.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "cpu_time.c"
 
 
@@ -39,7 +56,116 @@
 			  2: output the computed tour in TSP_VIEW format */
 #define TOURFILE   "result.tour"   /* the output file of computed tour */
 
-#define POPULATION 20  /* population of gene */
+#define FASTREAD   1   /* 1: parse a regular file on stdin through mmap();
+			  0: always use read_tspfile() */
+#define PARSE_CHUNK   (4<<20) /* min. bytes of coordinates per parser thread */
+#define PARSE_THREADS 8       /* max. number of parser threads */
+
+#define CACHEFILE  ""  /* binary cache of the instance ("": no cache) */
+#define CACHE_MAGIC "TSPBIN1" /* the first bytes of a cache file */
+#define CACHE_SECTIONS 6      /* x, y, order, start, adj and len */
+
+#define DEBUG      0   /* 1: check the solver components against the
+			  reference implementations before the search;
+			  2: also check every evaluation during the search */
+
+#define DISTMEM    256 /* memory budget of the distance cache in MB */
+
+#define POPULATION 20  /* population of gene (an even number, at least 4) */
+#define DIST_BAND_MAX 1024 /* max. half width of the band rows of the cache */
+#define EVAL_BLOCK 256 /* positions between two prefix costs of a route */
+#define SELECTION  0   /* selection of the parents (SEL_*) */
+#define TOURNAMENT 2   /* size of a tournament */
+#define TRUNCATION 50  /* percentage of the parents kept by truncation */
+
+#define SEL_RANKING     0 /* all individuals sorted by cost */
+#define SEL_TOURNAMENT  1 /* tournament selection */
+#define SEL_TRUNCATION  2 /* the best TRUNCATION % only */
+#define SEL_LINEAR_RANK 3 /* roulette on linear ranking weights */
+#define SEL_SUS         4 /* stochastic universal sampling on the same weights */
+#define SEL_NUM         5 /* number of selections */
+
+#define CROSSOVER  0   /* crossover of the parents (CX_*) */
+#define EAX_TRIALS 30  /* max. number of AB-cycles tried for an EAX child */
+
+#define CX_TWOPOINT     0 /* two-point crossover of the ordinal genes */
+#define CX_EAX          1 /* edge assembly crossover of the routes */
+#define CX_GPX          2 /* generalized partition crossover of the routes */
+#define CX_OX           3 /* order crossover of the routes */
+#define CX_PMX          4 /* partially mapped crossover of the routes */
+#define CX_ERX          5 /* edge recombination of the routes */
+#define CX_CX           6 /* cycle crossover of the routes */
+#define CX_MIXED        7 /* one of the route crossovers at random per child */
+#define CX_NUM          7 /* number of entries of the operator table */
+
+#define INIT       3   /* construction of the initial tours (INIT_*) */
+#define INIT_NOISE 0.2 /* max. relative noise of the randomised greedy edges */
+#define HILBERT_ORDER 16 /* the Hilbert curve runs on a 2^16 x 2^16 grid */
+#define RENUMBER   1   /* 1: renumber the nodes along a Hilbert curve during
+			  the search; 0: keep the numbering of the input */
+
+#define INIT_IDENTITY   0 /* 1, 2, ..., n (random tours for route crossovers) */
+#define INIT_HILBERT    1 /* order along a Hilbert curve */
+#define INIT_NN         2 /* nearest neighbour tour */
+#define INIT_GREEDY     3 /* greedy edge matching */
+
+#define DIST_FULL32 0  /* the distance cache is a full int matrix */
+#define DIST_FULL16 1  /* the distance cache is a full unsigned short matrix */
+#define DIST_BAND   2  /* the distance cache keeps the band |k-l|<=band only */
+
+#define ARENA_ALIGN   64            /* alignment of the population arena */
+#define HUGE_PAGE     (2UL<<20)     /* size of a huge page */
+#define ARENA_HEAP    0  /* the arena is allocated by posix_memalign() */
+#define ARENA_MMAP    1  /* the arena is mapped with (transparent) huge pages */
+
+#define SIMD       1   /* 1: evaluate tours with AVX2/AVX-512 if available;
+			  0: always use the scalar kernel */
+#define KERNEL_SAMPLE (1<<16) /* nodes of the path timing the kernels */
+#define KERNEL_EDGES  (1<<20) /* edges summed per timing of a kernel */
+#define SEED       0   /* seed of the random numbers (0: from the time) */
+#define RNG_LANES  4   /* generators advanced together by rng_fill() */
+#define NEIGHBORS  10  /* number of candidate neighbours of each node */
+#define QUADRANT   1   /* 1: quadrant-balanced neighbour lists;
+			  0: the nearest nodes only */
+#define KD_LEAF    8   /* max. number of nodes in a leaf of the k-d tree */
+#define THREADS    0   /* number of threads decoding and evaluating the
+			  population (0: the OpenMP default) */
+#define PARALLEL_MIN 1000 /* min. number of nodes to decode and evaluate
+			     the population in parallel */
+#define ISLANDS    1   /* number of islands, each on its own thread */
+#define TOPOLOGY   0   /* migration topology of the islands (TOPO_*) */
+#define MIGRATION  50  /* generations between two migrations */
+#define MIGRANTS   1   /* number of best individuals sent per migration */
+#define ISLANDMIX  0   /* 1: island i uses selection (selection+i) mod SEL_NUM */
+#define CHANNEL_SLOTS 4 /* capacity of a migration queue in migrations */
+
+#define PROCESSES  1   /* number of solver processes sharing their tours */
+#define NUMA       1   /* 1: pin process p to NUMA node p mod (number of nodes) */
+#define SHM_RETRY  8   /* max. attempts to read a tour under the seqlock */
+
+#define PORT       0   /* TCP port on which the tours of the peers are
+			  received (0: do not listen) */
+#define PEERS      ""  /* "host:port,host:port,...": peers to send to */
+#define NET_MAGIC  0x54535047u /* "GPST", the first 4 bytes of a frame */
+#define NET_HEADER 24  /* bytes of the header of a frame */
+#define NET_FULL   0   /* the frame holds the whole tour */
+#define NET_DELTA  1   /* the frame holds the changed neighbours only */
+
+#define TOPO_RING       0 /* island i sends to island i+1 */
+#define TOPO_TORUS      1 /* islands on a grid send to the right and down */
+
+#define LOCALSEARCH 3  /* local search applied to new individuals (LS_*) */
+#define OROPT_LEN  3   /* max. number of nodes moved by an Or-opt move */
+#define LK_DEPTH   10  /* max. number of 2-opt steps of a variable-depth move */
+#define LK_BREADTH 5   /* number of first steps tried by a variable-depth move */
+#define TWOLEVEL   5000 /* the local search keeps the tour in a two-level list
+			   from this number of nodes on (0: never) */
+#define TL_MIN     64  /* min. number of nodes of a two-level list */
+
+#define LS_NONE    0   /* no local search */
+#define LS_2OPT    1   /* 2-opt with neighbour lists and don't-look bits */
+#define LS_OROPT   2   /* 2-opt and Or-opt */
+#define LS_LK      3   /* 2-opt, Or-opt and variable-depth (LK-style) moves */
 
 
 typedef struct {
@@ -50,6 +176,33 @@ typedef struct {
   char   tourfile[MAX_STR];    /* the output file of computed tour */
   /* NEVER MODIFY THE ABOVE VARIABLES.  */
   /* You can add more components below. */
+  int    fastread;             /* 1: read the instance through mmap() */
+  char   cachefile[MAX_STR];   /* binary cache of the instance, "" for none */
+  int    debug;                /* 1, 2: run the self-checks; 0: do not */
+  int    distmem;              /* memory budget of the distance cache in MB */
+  int    simd;                 /* 1: use the SIMD tour length kernel */
+  unsigned long long seed;     /* seed of the random numbers, 0: the time */
+  int    population;           /* population of gene */
+  int    selection;            /* selection of the parents (SEL_*) */
+  int    tournament;           /* size of a tournament */
+  int    truncation;           /* percentage of the parents kept by truncation */
+  int    crossover;            /* crossover of the parents (CX_*) */
+  int    init;                 /* construction of the initial tours (INIT_*) */
+  int    neighbors;            /* number of candidate neighbours of each node */
+  int    quadrant;             /* 1: quadrant-balanced neighbour lists */
+  int    localsearch;          /* local search of new individuals (LS_*) */
+  int    twolevel;             /* min. number of nodes for the two-level list */
+  int    renumber;             /* 1: renumber the nodes along a Hilbert curve */
+  int    threads;              /* threads of the decoder and the evaluation */
+  int    islands;              /* number of islands (threads) */
+  int    topology;             /* migration topology (TOPO_*) */
+  int    migration;            /* generations between two migrations */
+  int    migrants;             /* individuals sent per migration */
+  int    islandmix;            /* 1: the islands use different selections */
+  int    processes;            /* number of processes (shared memory) */
+  int    numa;                 /* 1: pin the processes to NUMA nodes */
+  int    port;                 /* TCP port of this node, 0 for none */
+  char   peers[MAX_STR];       /* "host:port,..." of the nodes to send to */
 
 } Param;                /* parameters */
 
@@ -62,6 +215,200 @@ typedef struct{
   int      min_node_num;          /* minimum number of nodes the solution contains */
 } TSPdata;              /* data of TSP instance */
 
+typedef struct {
+  int            mode;         /* DIST_FULL32, DIST_FULL16 or DIST_BAND */
+  long long      (*path_length)( const double *xy, int *path, int m );
+                               /* kernel for paths without the matrix */
+  const char     *kernel;      /* name of the kernel */
+  int            n;            /* number of nodes */
+  int            band;         /* half width of the band rows */
+  int            *full32;      /* full[k*n+l] = dist(k,l) */
+  unsigned short *full16;      /* the same with 16 bits if it is enough */
+  unsigned short *rows;        /* rows[k*band+(l-k-1)] = dist(k,l), k<l<=k+band */
+  double         *xy;          /* xy[2k], xy[2k+1] = x[k], y[k] */
+} DistCache;            /* precomputed distances between nodes */
+
+typedef struct {
+  unsigned long long s[4];     /* xoshiro256** state of the stream */
+  unsigned long long lane[4][RNG_LANES];
+                               /* states of the lanes of rng_fill(), lane[k][l]
+				  is word k of lane l */
+} Rng;                  /* random number streams of a thread */
+
+typedef struct {
+  const char     *begin;       /* the first line of the chunk */
+  const char     *end;         /* the end of the last line of the chunk */
+  const char     *stop;        /* the end of the last line read */
+  int            first;        /* number of the first node of the chunk */
+  int            count;        /* number of node lines in the chunk */
+  int            eof;          /* 1: the chunk contains the EOF line */
+  int            error;        /* 1: a node line could not be read */
+  TSPdata        *tspdata;     /* the coordinates are stored here */
+} ParseChunk;           /* a part of NODE_COORD_SECTION for one parser thread */
+
+typedef struct {
+  char           magic[8];     /* CACHE_MAGIC */
+  char           name[MAX_STR];/* name of the instance */
+  int            n;            /* number of nodes */
+  int            min_node_num; /* minimum number of nodes of a solution */
+  int            renumber;     /* 1: the order section is the renumbering */
+  int            neighbors;    /* length of each neighbour list */
+  int            quadrant;     /* 1: quadrant-balanced neighbour lists */
+  int            pad;
+  long long      src_size;     /* size of the text file read, -1: not a file */
+  long long      src_mtime;    /* its modification time in nanoseconds */
+  long long      src_ino;      /* its inode number */
+  long long      src_end;      /* offset of the line after the instance */
+  unsigned long long sum;      /* checksum of the header and the sections */
+} CacheHeader;          /* header of the binary cache of an instance */
+
+typedef struct {
+  int           n;             /* number of nodes */
+  int           *perm;         /* nodes in the order of the tree */
+  double        *px;           /* px[i] = x[perm[i]] */
+  double        *py;           /* py[i] = y[perm[i]] */
+  unsigned char *cut;          /* coordinate that splits the subtree at mid */
+} KdTree;               /* implicit k-d tree over the coordinates */
+
+typedef struct {
+  int      u;                  /* the query node */
+  double   ux,uy;              /* its coordinates */
+  int      cap[5];             /* number of nodes wanted in each list */
+  int      num[5];             /* number of nodes found so far */
+  int      *id[5];             /* the nodes found, nearest first */
+  double   *d2[5];             /* their squared distances */
+} KnnQuery;             /* state of a nearest neighbour query; list q<4 holds
+			   the nodes of quadrant q, list 4 those of any one */
+
+typedef struct {
+  KdTree   *kd;                /* the tree */
+  int      *at;                /* at[v]: entry of node v in the tree */
+  char     *alive;             /* alive[i]=1: entry i is in the set */
+  int      *count;             /* count[mid]: entries in the set in the subtree
+				  split at mid */
+} KdSet;                /* a set of nodes with nearest queries on the k-d tree */
+
+typedef struct {
+  int      n;                  /* number of nodes */
+  int      k;                  /* max. length of a list */
+  int      *start;             /* the list of u is adj[start[u]..start[u+1]-1] */
+  int      *adj;               /* the neighbours, nearest first */
+  int      *len;               /* len[i] = dist(u,adj[i]) */
+} Neighbors;            /* candidate neighbour lists in CSR layout */
+
+typedef struct {
+  int      n;                  /* number of nodes */
+  int      segs;               /* number of segments */
+  int      *nx;                /* the next node in the order of its segment */
+  int      *pv;                /* the previous node in that order */
+  int      *seq;               /* increasing along nx within a segment */
+  int      *par;               /* the segment of each node */
+  int      *first;             /* the first node of a segment in its order */
+  int      *last;              /* the last node of a segment in its order */
+  int      *size;              /* number of nodes of a segment */
+  char     *rev;               /* 1: the tour runs through the segment backwards */
+  int      *rank;              /* position of a segment in the tour */
+  int      *snext;             /* the next segment in the tour */
+  int      *sprev;             /* the previous segment in the tour */
+} TwoLevel;             /* tour as a list of about sqrt(n) segments of nodes */
+
+typedef struct {
+  int       n;                 /* number of nodes */
+  int       twolevel;          /* 1: the tour is kept in tl, 0: in tour and pos */
+  TwoLevel  tl;                /* the two-level list of the tour */
+  int       *tour;             /* the tour being improved */
+  int       *pos;              /* pos[v] = position of node v in tour */
+  int       *queue;            /* circular queue of the nodes to be tried */
+  char      *active;           /* active[v]=1: v is queued (don't-look bit off) */
+  int       qhead;             /* first entry of the queue */
+  int       qnum;              /* number of entries in the queue */
+  long long moves;             /* number of improving 2-opt moves applied */
+  long long or_moves;          /* number of improving Or-opt moves applied */
+  long long lk_moves;          /* number of improving variable-depth moves */
+  double    time;              /* cpu time spent in the local search */
+  double    deadline;          /* search_time() at which the search stops */
+} LocalSearch;          /* state of the local search on an array tour */
+
+typedef struct {
+  int       n;                 /* number of nodes */
+  int       *alink;            /* alink[2v], alink[2v+1]: neighbours of v in A */
+  int       *link;             /* the same in the child being built */
+  int       *ra;               /* A-edges not yet in an AB-cycle (-1: none) */
+  int       *rb;               /* B-edges not yet in an AB-cycle (-1: none) */
+  int       *path;             /* the alternating path being traced */
+  int       *at;               /* at[2v+p]: index of v on path with parity p */
+  int       *cyc;              /* the nodes of all AB-cycles, A-edge first */
+  int       *cstart;           /* AB-cycle c is cyc[cstart[c]..cstart[c+1]-1] */
+  int       ncyc;              /* number of AB-cycles */
+  int       *order;            /* the AB-cycles in the order they are tried */
+  int       *comp;             /* subtour label of each node */
+  int       label;             /* next unused subtour label */
+  int       *cnext;            /* next node of the same subtour (-1: none) */
+  int       *chead;            /* first node of each subtour */
+  int       *ctail;            /* last node of each subtour */
+  int       *csize;            /* number of nodes of each subtour (0: merged) */
+  int       *touched;          /* nodes whose links may differ from A */
+  int       ntouched;          /* number of entries in touched */
+  double    deadline;          /* search_time() at which no more cycles are tried */
+} Eax;                  /* scratch of the edge assembly crossover of A and B */
+
+typedef struct {
+  int       n;                 /* number of nodes */
+  int       *alink;            /* alink[2v], alink[2v+1]: neighbours of v in A */
+  int       *blink;            /* the same in B */
+  int       *comp;             /* partition component of each node */
+  int       *stack;            /* nodes to be labelled */
+  int       *partner;          /* other end of the path of A through a component */
+  int       *state;            /* GPX_* state of each component */
+  long long *cost_a;           /* length of the A-edges of a component */
+  long long *cost_b;           /* length of the B-edges of a component */
+} Gpx;                  /* scratch of the partition crossover of A and B */
+
+#define GPX_FROM_A  0  /* the component keeps the A-edges */
+#define GPX_FEASIBLE 1 /* the component may take the B-edges */
+#define GPX_FROM_B  2  /* the component takes the B-edges */
+
+typedef struct {
+  int       n;                 /* number of nodes */
+  Eax       eax;               /* scratch of EAX */
+  Gpx       gpx;               /* scratch of GPX */
+  int       *pos;              /* position of each node in a parent */
+  int       *mark;             /* mark[v]==stamp: v is marked */
+  int       stamp;             /* current value of a mark */
+  int       *adj;              /* adj[4v..4v+deg[v]-1]: edges of v in A or B */
+  int       *deg;              /* number of those edges not yet used */
+  int       *rest;             /* nodes not yet in the child */
+  int       *at;               /* position of each node in rest */
+} Recomb;               /* preallocated scratch of the route crossovers */
+
+typedef struct {
+  long long cost;              /* cost of the individual */
+  int       idx;               /* index of the individual */
+} Ranked;               /* an individual to be sorted by the selection */
+
+typedef struct {
+  void     *base;              /* the allocated block */
+  size_t   size;               /* its size in bytes */
+  int      kind;               /* ARENA_HEAP or ARENA_MMAP */
+  int      pop;                /* population of gene */
+  int      n;                  /* number of nodes */
+  int      *gene_a;            /* pop x n ordinal genes */
+  int      *gene_b;            /* pop x n genes of the next generation */
+  int      *route_a;           /* pop x n decoded routes */
+  int      *route_b;           /* pop x n routes of the next generation */
+  long long *fitness;          /* cost of each route */
+  long long *head_a;           /* prefix costs of each route, prefix_stride(n)
+				  entries per route (see prefix_cost()) */
+  long long *head_b;           /* prefix costs of the next generation */
+  int      *dirty;             /* first gene changed since the route was decoded */
+  int      *polish;            /* 1: the route is a new child for the local search */
+  int      *src;               /* the parent of each slot of the next generation */
+  Ranked   *rank;              /* pop scratch entries for the selection */
+  int      *tree;              /* n+1 scratch entries for the decoder per thread,
+				  tree_stride(n) apart */
+  int      threads;            /* number of decoder scratch blocks */
+} Population;           /* all buffers of the population in one block */
+
 typedef struct {
   double        timebrid;       /* the time before reading the instance data */
   double        starttime;      /* the time the search started */
@@ -69,9 +416,111 @@ typedef struct {
   int           *bestsol;       /* the best solution found so far */
   /* NEVER MODIFY THE ABOVE FOUR VARIABLES. */
   /* You can add more components below. */
+  DistCache     dcache;         /* precomputed distances */
+  long long     bestcost;       /* cost of bestsol found by the search */
+  KdTree        kdtree;         /* k-d tree over the coordinates */
+  Neighbors     nb;             /* candidate neighbour lists, read only */
+  CacheHeader   cache;          /* the source of the instance for the cache */
+  int           cached;         /* 1: the cache matched the instance and the
+				   parameters, so it is not written again */
+  int           *order;         /* order[k] = input number of node k while the
+				   nodes are renumbered, NULL otherwise */
 
 } Vdata;                /* various data often necessary during the search */
 
+typedef struct {
+  const char *name;            /* name of the operator */
+  long long  (*child)( Recomb *R, int *A, int *B, long long cost, int *child,
+                       TSPdata *tspdata, Vdata *vdata );
+                               /* writes the child of A and B, returns its cost */
+  int        polish;           /* 1: the child is improved by the local search */
+  long long  children;         /* number of children generated */
+  long long  improved;         /* number of children shorter than both parents */
+  double     time;             /* cpu time spent in the operator */
+} Operator;             /* an entry of the crossover table */
+
+typedef struct {
+  int       n;                 /* number of nodes of a tour */
+  int       slots;             /* capacity of the queue */
+  int       *route;            /* slots x n tours */
+  long long *cost;             /* cost of each tour */
+  unsigned long head __attribute__((aligned(ARENA_ALIGN)));
+                               /* next slot to read, written by the consumer */
+  unsigned long tail __attribute__((aligned(ARENA_ALIGN)));
+                               /* next slot to write, written by the producer */
+} Channel;              /* lock-free single-producer single-consumer queue of tours */
+
+typedef struct {
+  unsigned long seq __attribute__((aligned(ARENA_ALIGN)));
+                               /* seqlock, odd while the tour is written */
+  long long     cost;          /* cost of the tour, LLONG_MAX: none yet */
+} ShmSlot;              /* a tour in the shared segment, its n nodes follow */
+
+typedef struct {
+  char      *base;             /* the mapped segment */
+  size_t    size;              /* its size in bytes */
+  size_t    stride;            /* bytes from one slot to the next */
+  int       procs;             /* number of processes */
+  int       proc;              /* number of this process */
+  int       n;                 /* number of nodes */
+  unsigned long seen;          /* seq of the neighbour's tour taken last */
+  int       *tour;             /* n scratch entries for a tour read */
+} Shared;               /* the shared memory of the solver processes: slot 0
+			   is the global best, slot 1+p the best of process p */
+
+typedef struct {
+  int       fd;                /* socket, -1 if closed */
+  int       connecting;        /* 1: the connect() is in progress */
+  struct sockaddr_storage addr; /* address of the peer (links to peers) */
+  socklen_t addrlen;           /* its length, 0 for accepted links */
+  unsigned char *buf;          /* frame to send or bytes received */
+  size_t    len;               /* number of bytes in buf */
+  size_t    done;              /* bytes of buf already sent */
+  size_t    cap;               /* capacity of buf */
+  int       *base;             /* the last tour sent or received on the link */
+  long long cost;              /* its cost, LLONG_MAX: none */
+} NetLink;              /* a TCP connection to or from another node */
+
+typedef struct {
+  int       n;                 /* number of nodes */
+  int       listen_fd;         /* socket accepting the peers, -1 for none */
+  NetLink   *out;              /* links to param->peers */
+  int       nout;              /* number of entries of out */
+  NetLink   *in;               /* links accepted from the other nodes */
+  int       nin;               /* number of entries of in */
+  int       *tour;             /* n scratch entries for a tour decoded */
+  int       *adj;              /* 2n scratch entries for the neighbours */
+  long long frames;            /* number of tours sent */
+  long long deltas;            /* those sent as changed neighbours only */
+  long long bytes;             /* bytes of the frames sent */
+  long long full_bytes;        /* bytes they would take as whole tours */
+  long long received;          /* number of tours received */
+  long long rejected;          /* tours received which were not valid */
+  long long accepted;          /* tours taken into the population */
+} Network;              /* the tours exchanged with the other nodes over TCP */
+
+typedef struct {
+  int         id;              /* number of the island */
+  Param       param;           /* the settings of this island */
+  TSPdata     *tspdata;        /* the instance, read only */
+  Vdata       vdata;           /* shared caches and lists, its own bestsol */
+  double      deadline;        /* search_time() at which the search stops */
+  unsigned long long node;     /* node_key() of this node, mixed into the seed */
+  Channel     *in[2];          /* queues of the migrants to this island */
+  Channel     *out[2];         /* queues of the migrants from this island */
+  int         nin;             /* number of entries of in */
+  int         nout;            /* number of entries of out */
+  LocalSearch ls;              /* the local search and its statistics */
+  Operator    op[CX_NUM];      /* the crossover table and its statistics */
+  long long   mutations;       /* number of mutations */
+  double      mutation_time;   /* cpu time spent in the mutation */
+  long long   generations;     /* number of generations */
+  long long   sent;            /* number of migrants sent */
+  long long   accepted;        /* number of migrants taken into the population */
+  Shared      *shm;            /* the other processes (island 0 only), or NULL */
+  Network     *net;            /* the other nodes (island 0 only), or NULL */
+} Island;               /* one population of the island model */
+
 /************************ declaration of functions ***************************/
 FILE *open_file( char *fname, char *mode );
 void *malloc_e( size_t size );
@@ -120,6 +569,33 @@ void copy_parameters( int argc, char *argv[], Param *param ){
   param->givesol    = GIVESOL;
   param->outformat  = OUTFORMAT;
   strcpy(param->tourfile,TOURFILE);
+  param->fastread   = FASTREAD;
+  strcpy(param->cachefile,CACHEFILE);
+  param->debug      = DEBUG;
+  param->distmem    = DISTMEM;
+  param->simd       = SIMD;
+  param->seed       = SEED;
+  param->population = POPULATION;
+  param->selection  = SELECTION;
+  param->tournament = TOURNAMENT;
+  param->truncation = TRUNCATION;
+  param->crossover  = CROSSOVER;
+  param->init       = INIT;
+  param->neighbors  = NEIGHBORS;
+  param->quadrant   = QUADRANT;
+  param->localsearch= LOCALSEARCH;
+  param->twolevel   = TWOLEVEL;
+  param->renumber   = RENUMBER;
+  param->threads    = THREADS;
+  param->islands    = ISLANDS;
+  param->topology   = TOPOLOGY;
+  param->migration  = MIGRATION;
+  param->migrants   = MIGRANTS;
+  param->islandmix  = ISLANDMIX;
+  param->processes  = PROCESSES;
+  param->numa       = NUMA;
+  param->port       = PORT;
+  strcpy(param->peers,PEERS);
   
   /**** read the parameters ****/
   if(argc>0 && (argc % 2)==0){
@@ -133,8 +609,73 @@ void copy_parameters( int argc, char *argv[], Param *param ){
       if(strcmp(argv[i],"givesol")==0)    param->givesol    = atoi(argv[i+1]);
       if(strcmp(argv[i],"outformat")==0)  param->outformat  = atoi(argv[i+1]);
       if(strcmp(argv[i],"tourfile")==0)   strcpy(param->tourfile,argv[i+1]);
+      if(strcmp(argv[i],"fastread")==0)   param->fastread   = atoi(argv[i+1]);
+      if(strcmp(argv[i],"cachefile")==0)  strcpy(param->cachefile,argv[i+1]);
+      if(strcmp(argv[i],"debug")==0)      param->debug      = atoi(argv[i+1]);
+      if(strcmp(argv[i],"distmem")==0)    param->distmem    = atoi(argv[i+1]);
+      if(strcmp(argv[i],"simd")==0)       param->simd       = atoi(argv[i+1]);
+      if(strcmp(argv[i],"seed")==0)       param->seed       = strtoull(argv[i+1],NULL,10);
+      if(strcmp(argv[i],"population")==0) param->population = atoi(argv[i+1]);
+      if(strcmp(argv[i],"selection")==0)  param->selection  = atoi(argv[i+1]);
+      if(strcmp(argv[i],"tournament")==0) param->tournament = atoi(argv[i+1]);
+      if(strcmp(argv[i],"truncation")==0) param->truncation = atoi(argv[i+1]);
+      if(strcmp(argv[i],"crossover")==0)  param->crossover  = atoi(argv[i+1]);
+      if(strcmp(argv[i],"init")==0)       param->init       = atoi(argv[i+1]);
+      if(strcmp(argv[i],"neighbors")==0)  param->neighbors  = atoi(argv[i+1]);
+      if(strcmp(argv[i],"quadrant")==0)   param->quadrant   = atoi(argv[i+1]);
+      if(strcmp(argv[i],"localsearch")==0)param->localsearch= atoi(argv[i+1]);
+      if(strcmp(argv[i],"twolevel")==0)   param->twolevel   = atoi(argv[i+1]);
+      if(strcmp(argv[i],"renumber")==0)   param->renumber   = atoi(argv[i+1]);
+      if(strcmp(argv[i],"threads")==0)    param->threads    = atoi(argv[i+1]);
+      if(strcmp(argv[i],"islands")==0)    param->islands    = atoi(argv[i+1]);
+      if(strcmp(argv[i],"topology")==0)   param->topology   = atoi(argv[i+1]);
+      if(strcmp(argv[i],"migration")==0)  param->migration  = atoi(argv[i+1]);
+      if(strcmp(argv[i],"migrants")==0)   param->migrants   = atoi(argv[i+1]);
+      if(strcmp(argv[i],"islandmix")==0)  param->islandmix  = atoi(argv[i+1]);
+      if(strcmp(argv[i],"processes")==0)  param->processes  = atoi(argv[i+1]);
+      if(strcmp(argv[i],"numa")==0)       param->numa       = atoi(argv[i+1]);
+      if(strcmp(argv[i],"port")==0)       param->port       = atoi(argv[i+1]);
+      if(strcmp(argv[i],"peers")==0)      strcpy(param->peers,argv[i+1]);
     }
   }
+  if(param->population<4 || param->population%2!=0){
+    fprintf(stderr,"error: population must be an even number of at least 4.\n");
+    exit(EXIT_FAILURE);
+  }
+  if(param->crossover<CX_TWOPOINT || param->crossover>CX_MIXED){
+    fprintf(stderr,"error: crossover must be from %d to %d.\n",CX_TWOPOINT,CX_MIXED);
+    exit(EXIT_FAILURE);
+  }
+  if(param->islands<1 || param->processes<1 || param->migration<1 || param->migrants<0){
+    fprintf(stderr,"error: islands, processes and migration must be at least 1, migrants at least 0.\n");
+    exit(EXIT_FAILURE);
+  }
+  if(param->topology<TOPO_RING || param->topology>TOPO_TORUS){
+    fprintf(stderr,"error: topology must be %d or %d.\n",TOPO_RING,TOPO_TORUS);
+    exit(EXIT_FAILURE);
+  }
+  if(param->init<INIT_IDENTITY || param->init>INIT_GREEDY){
+    fprintf(stderr,"error: init must be from %d to %d.\n",INIT_IDENTITY,INIT_GREEDY);
+    exit(EXIT_FAILURE);
+  }
+  if(param->localsearch<LS_NONE || param->localsearch>LS_LK){
+    fprintf(stderr,"error: localsearch must be from %d to %d.\n",LS_NONE,LS_LK);
+    exit(EXIT_FAILURE);
+  }
+  if(param->neighbors<0){
+    fprintf(stderr,"error: neighbors must be at least 0.\n");
+    exit(EXIT_FAILURE);
+  }
+  if(param->selection<SEL_RANKING || param->selection>=SEL_NUM || param->tournament<1
+     || param->truncation<1 || param->truncation>100){
+    fprintf(stderr,"error: selection must be from %d to %d, tournament at least 1, truncation from 1 to 100.\n",
+            SEL_RANKING,SEL_NUM-1);
+    exit(EXIT_FAILURE);
+  }
+  if(param->distmem<0){
+    fprintf(stderr,"error: distmem must be at least 0.\n");
+    exit(EXIT_FAILURE);
+  }
 }
 
 
@@ -146,6 +687,8 @@ void prepare_memory( TSPdata *tspdata, Vdata *vdata ){
   tspdata->x       = (double*)malloc_e(n*sizeof(double));
   tspdata->y       = (double*)malloc_e(n*sizeof(double));
   vdata->bestsol   = (int*)malloc_e(n*sizeof(int));
+  vdata->order     = NULL;
+  vdata->nb.adj    = NULL;
   /* the next line is just to give an initial solution */
   for(k=0;k<n;k++)
     vdata->bestsol[k]=k;
@@ -237,6 +780,391 @@ void read_tourfile( FILE *in, TSPdata *tspdata, int *tour ){
 }
 
 
+/***** the number at p (after blanks) in the format of strtod() *************/
+/***** returns the end of the number, or NULL if there is none ***************/
+/***** up to 19 digits and |exponent|<=22 are converted exactly here, ********/
+/***** the rest is left to strtod() so that the value is always the same *****/
+const char *scan_number( const char *p, const char *end, double *v ){
+  static const double pow10[23]={
+    1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+    1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+  unsigned long long m=0;
+  int neg=0,digits=0,e=0,ex=0,eneg=0;
+  const char *s,*q;
+  char buf[MAX_STR];
+
+  while(p<end && (*p==' ' || *p=='\t')) p++;
+  s=p;
+  if(p<end && (*p=='-' || *p=='+')){ neg=(*p=='-'); p++; }
+  for(;p<end && *p>='0' && *p<='9';p++,digits++)
+    if(digits<19) m=m*10+(*p-'0');
+  if(p<end && *p=='.')
+    for(p++;p<end && *p>='0' && *p<='9';p++,digits++)
+      if(digits<19){ m=m*10+(*p-'0'); e--; }
+  if(digits==0) return NULL;
+  if(p<end && (*p=='e' || *p=='E')){
+    q=p+1;
+    if(q<end && (*q=='-' || *q=='+')){ eneg=(*q=='-'); q++; }
+    if(q<end && *q>='0' && *q<='9'){
+      for(p=q;p<end && *p>='0' && *p<='9';p++)
+        if(ex<10000) ex=ex*10+(*p-'0');
+      e+=eneg ? -ex : ex;
+    }
+  }
+  if(digits<=19 && m<(1ULL<<53) && e>=-22 && e<=22){
+    *v = e<0 ? (double)m/pow10[-e] : (double)m*pow10[e];
+    if(neg) *v=-*v;
+    return p;
+  }
+  if(p-s>=MAX_STR) return NULL;
+  memcpy(buf,s,p-s);
+  buf[p-s]='\0';
+  *v=strtod(buf,NULL);
+  return p;
+}
+
+/***** the line after the one at p *******************************************/
+const char *next_line( const char *p, const char *end ){
+  const char *q=(const char*)memchr(p,'\n',end-p);
+  return q==NULL ? end : q+1;
+}
+
+/***** kind of the line at p: 1: a node, 0: blank, -1: EOF *******************/
+int coord_line( const char *p, const char *end ){
+  while(p<end && (*p==' ' || *p=='\t' || *p=='\r')) p++;
+  if(p==end || *p=='\n') return 0;
+  if(end-p>=3 && strncmp(p,"EOF",3)==0) return -1;
+  return 1;
+}
+
+/***** count the node lines of a chunk (the first pass of the threads) *****/
+void *count_chunk( void *arg ){
+  ParseChunk *c=(ParseChunk*)arg;
+  const char *p;
+  int kind;
+
+  c->count=0;
+  c->eof=0;
+  for(p=c->begin;p<c->end;p=next_line(p,c->end)){
+    if((kind=coord_line(p,c->end))<0){ c->eof=1; break; }
+    c->count+=kind;
+  }
+  return NULL;
+}
+
+/***** read the coordinates of the nodes first, first+1, ... of a chunk *****/
+void *parse_chunk( void *arg ){
+  ParseChunk *c=(ParseChunk*)arg;
+  TSPdata *tspdata=c->tspdata;
+  const char *p,*q;
+  double id;
+  int k,kind;
+
+  c->error=0;
+  c->stop=NULL;
+  for(p=c->begin,k=c->first;p<c->end && k<tspdata->n;p=next_line(p,c->end)){
+    if((kind=coord_line(p,c->end))<0) break;
+    if(kind==0) continue;
+    if((q=scan_number(p,c->end,&id))==NULL
+       || (q=scan_number(q,c->end,&tspdata->x[k]))==NULL
+       || (q=scan_number(q,c->end,&tspdata->y[k]))==NULL){
+      c->error=1;
+      break;
+    }
+    k++;
+    c->stop=next_line(p,c->end);
+  }
+  c->count=k-c->first;
+  return NULL;
+}
+
+/***** read the instance from a regular file through mmap() ******************/
+/***** the same header and coordinates as read_tspfile(), but the lines *****/
+/***** may end with blanks or "\r" and the numbers are scanned by hand; *****/
+/***** large coordinate sections are split among PARSE_THREADS threads. *****/
+/***** returns 0 without reading anything if "in" cannot be mapped, *********/
+/***** otherwise "in" is left after the last node as read_tspfile() does ****/
+int read_tspfile_mmap( FILE *in, TSPdata *tspdata, Vdata *vdata ){
+  struct stat st;
+  char *map,str[MAX_STR],*w,*u;
+  char name[MAX_STR]="",dim[MAX_STR]="",type[MAX_STR]="",edge[MAX_STR]="",min[MAX_STR]="";
+  const char *p,*q,*end,*stop=NULL;
+  off_t pos;
+  int k,t,len,fd,threads;
+  long cpus;
+  ParseChunk chunk[PARSE_THREADS];
+  pthread_t th[PARSE_THREADS];
+
+  fd=fileno(in);
+  if(fstat(fd,&st)!=0 || !S_ISREG(st.st_mode) || st.st_size==0) return 0;
+  if((pos=lseek(fd,0,SEEK_CUR))<0 || pos>=st.st_size) return 0;
+  map=(char*)mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  if(map==MAP_FAILED) return 0;
+  madvise(map,st.st_size,MADV_SEQUENTIAL);
+  end=map+st.st_size;
+
+  /* the header up to NODE_COORD_SECTION */
+  for(p=map+pos;;p=q){
+    if(p>=end){
+      fprintf(stderr,"error: invalid data input.\n");
+      exit(EXIT_FAILURE);
+    }
+    q=next_line(p,end);
+    len=(q-p<MAX_STR) ? (int)(q-p) : MAX_STR-1;
+    memcpy(str,p,len);
+    str[len]='\0';
+    w = strtok(str," :\t\r\n");
+    u = strtok(NULL," :\t\r\n");
+    if(w!=NULL && u==NULL && strcmp(w,"NODE_COORD_SECTION")==0){ p=q; break; }
+    if(w!=NULL && u==NULL && strcmp(w,"TOUR_SECTION")==0){
+      fprintf(stderr,"error: invalid instance.\n");
+      exit(EXIT_FAILURE);
+    }
+    if(w==NULL || u==NULL) continue;
+    if(strcmp("NAME",w)==0)                  strcpy(name,u);
+    if(strcmp("DIMENSION",w)==0)             strcpy(dim,u);
+    if(strcmp("TYPE",w)==0)                  strcpy(type,u);
+    if(strcmp("EDGE_WEIGHT_TYPE",w)==0)      strcpy(edge,u);
+    if(strcmp("MIN_NODE_NUM",w)==0)          strcpy(min,u);
+  }
+  strcpy(tspdata->name,name);
+  tspdata->n=atoi(dim);
+  /* without MIN_NODE_NUM every node must be visited */
+  tspdata->min_node_num = (min[0]!='\0') ? atoi(min) : tspdata->n;
+  if(strcmp("TSP",type)!=0 || strcmp("EUC_2D",edge)!=0 || tspdata->n<=0){
+    fprintf(stderr,"error: invalid instance.\n");
+    exit(EXIT_FAILURE);
+  }
+  prepare_memory(tspdata,vdata);
+
+  /* chunks of at least PARSE_CHUNK bytes starting at a line each */
+  cpus=sysconf(_SC_NPROCESSORS_ONLN);
+  threads=(int)((end-p)/PARSE_CHUNK);
+  if(threads>PARSE_THREADS) threads=PARSE_THREADS;
+  if(threads>cpus)          threads=(int)cpus;
+  if(threads<1)             threads=1;
+  for(t=0;t<threads;t++){
+    chunk[t].begin = (t==0) ? p : chunk[t-1].end;
+    chunk[t].end = (t==threads-1) ? end
+      : next_line(p+(end-p)/threads*(t+1),end);
+    chunk[t].tspdata=tspdata;
+    chunk[t].first=0;
+  }
+
+  /* the first node of each chunk from the counts of the chunks before it */
+  if(threads>1){
+    for(t=1;t<threads;t++) pthread_create(&th[t],NULL,count_chunk,&chunk[t]);
+    count_chunk(&chunk[0]);
+    for(t=1;t<threads;t++) pthread_join(th[t],NULL);
+    for(t=1;t<threads && !chunk[t-1].eof;t++)
+      chunk[t].first=chunk[t-1].first+chunk[t-1].count;
+    threads=t;
+  }
+  for(t=1;t<threads;t++) pthread_create(&th[t],NULL,parse_chunk,&chunk[t]);
+  parse_chunk(&chunk[0]);
+  for(t=1;t<threads;t++) pthread_join(th[t],NULL);
+
+  k=0;
+  for(t=0;t<threads;t++){
+    if(chunk[t].error){ k=-1; break; }
+    if(chunk[t].count>0){
+      k=chunk[t].first+chunk[t].count;
+      stop=chunk[t].stop;
+    }
+  }
+  if(k!=tspdata->n){
+    fprintf(stderr,"error: invalid instance.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* a tour that follows the instance is read from "in" as before */
+  fseek(in,(long)(stop-map),SEEK_SET);
+  munmap(map,st.st_size);
+  return 1;
+}
+
+
+/***** checksum of a block, eight bytes at a time ****************************/
+unsigned long long cache_sum( unsigned long long h, const void *p, size_t size ){
+  const unsigned char *b=(const unsigned char*)p;
+  unsigned long long w;
+  size_t i;
+
+  for(i=0;i+8<=size;i+=8){
+    memcpy(&w,b+i,8);
+    h=(h^w)*0x100000001b3ULL;
+    h^=h>>29;
+  }
+  for(;i<size;i++)
+    h=(h^b[i])*0x100000001b3ULL;
+  return h;
+}
+
+/***** offsets of the sections of a cache file, each aligned to 8 bytes: *****/
+/***** x, y, order, start, adj, len and the end of the file ******************/
+void cache_layout( CacheHeader *h, size_t off[CACHE_SECTIONS+1] ){
+  size_t n=h->n,lists=(size_t)n*h->neighbors+1;
+  size_t size[CACHE_SECTIONS];
+  int s;
+
+  size[0]=n*sizeof(double);
+  size[1]=n*sizeof(double);
+  size[2]=h->renumber ? n*sizeof(int) : 0;
+  size[3]=(n+1)*sizeof(int);
+  size[4]=lists*sizeof(int);
+  size[5]=lists*sizeof(int);
+  off[0]=(sizeof(CacheHeader)+7)/8*8;
+  for(s=0;s<CACHE_SECTIONS;s++)
+    off[s+1]=off[s]+(size[s]+7)/8*8;
+}
+
+/***** checksum of the header (without the checksum) and all sections *****/
+unsigned long long cache_checksum( CacheHeader *h, const char *map, size_t off[CACHE_SECTIONS+1] ){
+  CacheHeader c=*h;
+
+  c.sum=0;
+  return cache_sum(cache_sum(0xcbf29ce484222325ULL,&c,sizeof(c)),
+                   map+off[0],off[CACHE_SECTIONS]-off[0]);
+}
+
+/***** remember the file on "in" the instance was read from; it is *********/
+/***** called right after reading, before a given tour is read **************/
+void note_instance_source( FILE *in, TSPdata *tspdata, Vdata *vdata ){
+  struct stat st;
+  CacheHeader *h=&vdata->cache;
+
+  (void)tspdata;   /* same arguments as the readers */
+  h->src_size=-1;
+  if(fstat(fileno(in),&st)!=0 || !S_ISREG(st.st_mode)) return;
+  h->src_size=st.st_size;
+  h->src_mtime=(long long)st.st_mtim.tv_sec*1000000000LL+st.st_mtim.tv_nsec;
+  h->src_ino=st.st_ino;
+  h->src_end=ftell(in);
+}
+
+/***** read the instance from the cache file of param->cachefile **********/
+/***** returns 0 if there is no cache, the instance on "in" is not a *******/
+/***** regular file, or the cache is stale or broken; otherwise the *******/
+/***** coordinates are mapped from the cache, the lists and the order ******/
+/***** are taken if they were made with the same parameters, and "in" is ***/
+/***** left after the instance for read_tourfile() *************************/
+int read_instance_cache( Param *param, FILE *in, TSPdata *tspdata, Vdata *vdata ){
+  struct stat st,src;
+  CacheHeader *h;
+  char *map;
+  size_t off[CACHE_SECTIONS+1];
+  int k,K,fd,n;
+
+  vdata->cached=0;
+  if(param->cachefile[0]=='\0') return 0;
+  if(fstat(fileno(in),&src)!=0 || !S_ISREG(src.st_mode)) return 0;
+  if((fd=open(param->cachefile,O_RDONLY))<0) return 0;
+  if(fstat(fd,&st)!=0 || st.st_size<(off_t)sizeof(CacheHeader)){ close(fd); return 0; }
+  map=(char*)mmap(NULL,st.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(map==MAP_FAILED) return 0;
+
+  /* the same source file and a complete, unchanged cache */
+  h=(CacheHeader*)map;
+  if(memcmp(h->magic,CACHE_MAGIC,sizeof(h->magic))!=0 || h->n<=0 || h->neighbors<0
+     || h->src_size!=src.st_size || h->src_ino!=(long long)src.st_ino
+     || h->src_mtime!=(long long)src.st_mtim.tv_sec*1000000000LL+src.st_mtim.tv_nsec){
+    munmap(map,st.st_size);
+    return 0;
+  }
+  cache_layout(h,off);
+  if(off[CACHE_SECTIONS]!=(size_t)st.st_size || cache_checksum(h,map,off)!=h->sum){
+    fprintf(stderr,"warning: broken cache %s is made again.\n",param->cachefile);
+    munmap(map,st.st_size);
+    return 0;
+  }
+
+  n=h->n;
+  strcpy(tspdata->name,h->name);
+  tspdata->n=n;
+  tspdata->min_node_num=h->min_node_num;
+  tspdata->x=(double*)(map+off[0]);
+  tspdata->y=(double*)(map+off[1]);
+  vdata->bestsol=(int*)malloc_e(n*sizeof(int));
+  for(k=0;k<n;k++)
+    vdata->bestsol[k]=k;
+  vdata->cache=*h;
+  vdata->order=NULL;
+  vdata->nb.adj=NULL;
+  if(h->renumber && param->renumber){
+    vdata->order=(int*)malloc_e(n*sizeof(int));
+    memcpy(vdata->order,map+off[2],n*sizeof(int));
+  }
+  /* the lists as prepare_neighbors() would make them */
+  K=param->neighbors;
+  if(K>n-1) K=n-1;
+  if(K<0)   K=0;
+  if(h->neighbors==K && h->quadrant==param->quadrant
+     && h->renumber==(param->renumber && n>=2)){
+    vdata->nb.n=n;
+    vdata->nb.k=K;
+    vdata->nb.start=(int*)(map+off[3]);
+    vdata->nb.adj=(int*)(map+off[4]);
+    vdata->nb.len=(int*)(map+off[5]);
+    vdata->cached=1;
+  }
+
+  fseek(in,(long)h->src_end,SEEK_SET);
+  return 1;
+}
+
+/***** write the instance, the renumbering and the neighbour lists to *****/
+/***** param->cachefile; the coordinates are kept in the input numbering ***/
+void write_instance_cache( Param *param, TSPdata *tspdata, Vdata *vdata ){
+  CacheHeader h=vdata->cache;
+  FILE *out;
+  char *map,tmp[MAX_STR+8];
+  size_t off[CACHE_SECTIONS+1];
+  int k,n;
+
+  if(h.src_size<0 || strlen(param->cachefile)>=MAX_STR) return;
+  n=tspdata->n;
+  memcpy(h.magic,CACHE_MAGIC,sizeof(h.magic));
+  strcpy(h.name,tspdata->name);
+  h.n=n;
+  h.min_node_num=tspdata->min_node_num;
+  h.renumber=(vdata->order!=NULL);
+  h.neighbors=vdata->nb.k;
+  h.quadrant=param->quadrant;
+  cache_layout(&h,off);
+
+  /* the whole file is built in memory for the checksum */
+  map=(char*)calloc(off[CACHE_SECTIONS],1);
+  if(map==NULL) return;
+  for(k=0;k<n;k++){
+    int v = h.renumber ? vdata->order[k] : k;
+    ((double*)(map+off[0]))[v]=tspdata->x[k];
+    ((double*)(map+off[1]))[v]=tspdata->y[k];
+  }
+  if(h.renumber) memcpy(map+off[2],vdata->order,n*sizeof(int));
+  memcpy(map+off[3],vdata->nb.start,(n+1)*sizeof(int));
+  memcpy(map+off[4],vdata->nb.adj,(size_t)vdata->nb.start[n]*sizeof(int));
+  memcpy(map+off[5],vdata->nb.len,(size_t)vdata->nb.start[n]*sizeof(int));
+  h.sum=0;
+  memcpy(map,&h,sizeof(h));
+  h.sum=cache_checksum(&h,map,off);
+  memcpy(map,&h,sizeof(h));
+
+  /* written under another name first so that no half-written cache is read */
+  sprintf(tmp,"%s.tmp",param->cachefile);
+  if((out=fopen(tmp,"wb"))==NULL){
+    free(map);
+    return;
+  }
+  k=(fwrite(map,1,off[CACHE_SECTIONS],out)!=off[CACHE_SECTIONS]);
+  if(fclose(out)!=0 || k || rename(tmp,param->cachefile)!=0){
+    fprintf(stderr,"warning: cache %s could not be written.\n",param->cachefile);
+    remove(tmp);
+  }
+  free(map);
+}
+
+
 /***** output the tour in the TSPLIB format **********************************/
 /***** note: the output tour starts from the node "1" ************************/
 void output_tour( FILE *out, TSPdata *tspdata, int *tour ){
@@ -333,286 +1261,4859 @@ int is_feasible( TSPdata *tspdata, int *tour ){
 }
 
 /* my function and algorithm ********************************************************/
-void print_array(int *a, int n){
-    int i, s[n];
 
-    
-    for (i = 0; i < n; i++)
-    {
-        s[i] = a[i];
-        printf("%d ", s[i]);
-    }
-    printf("\n");
-}
+/***** user cpu time of the calling thread in seconds, as cpu_time() *******/
+/***** gives it for the process; the statistics of the operators of an *****/
+/***** island are measured with it, the time limit with search_time() *****/
+double thread_time( void ){
+#ifdef RUSAGE_THREAD
+  struct rusage tmp;
 
-void print_matrix(int n, int a[][n]){
-    int i, j;
-    
-    for (i = 0; i < POPULATION; i++)
-    {
-        for (j = 0; j < n; j++)
-        {
-            printf("%d ", a[i][j]);
-        }
-        printf("\n");
-    }
+  if(getrusage(RUSAGE_THREAD,&tmp)==0)
+    return (double)tmp.ru_utime.tv_sec+(double)tmp.ru_utime.tv_usec/1000000;
+#endif
+  return cpu_time();
 }
 
-void create_matrix(int n, int a[][n])
-{
-    int i, j;
+/***** user and system cpu time of all threads of the process in seconds; **/
+/***** the islands stop at one deadline on this clock, which also counts ***/
+/***** the time spent in the kernel reading it and exchanging tours ********/
+double search_time( void ){
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+  struct timespec t;
 
-    for (i = 0; i < POPULATION; i++)
-    {
-        for (j = 0; j < n; j++)
-        {
-            a[i][j] = rand() % (n - j) + 1;
-        }
-    }
+  if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID,&t)==0)
+    return (double)t.tv_sec+(double)t.tv_nsec/1e9;
+#endif
+  return cpu_time();
 }
 
-void copy_array(int *a, int n, int j)
-{
-    int i;
+/***** number of threads of the parallel loops over the population **********/
+int max_threads( void ){
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
 
-    for (i = 0; i < n; i++)
-    {
-        if (i == j - 1)
-        {
-            a[i] = a[i + 1];
-            for (i = j; i < n - 1; i++)
-            {
-                a[i] = a[i + 1];
-            }
-            a[n - 1] = 0;
-        }
-    }  
+/***** number of the calling thread in a parallel loop **********************/
+int thread_num( void ){
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
 }
 
-int min(int *a)
-{
-  int i, min;
-  min = a[POPULATION-1];
+/***** entries of the prefix costs of one route: the number of valid ******/
+/***** ones and the cost up to every EVAL_BLOCK-th position *****************/
+size_t prefix_stride( int n ){
+  return (size_t)(n-1)/EVAL_BLOCK+1;
+}
 
-  for (i = 0; i < POPULATION; i++)
-  {
-    if (min > a[i])
-    {
-    min = a[i];
-    }
-  }
-  
-  return min;
+/***** distance between the decoder scratch blocks of two threads, **********/
+/***** a multiple of ARENA_ALIGN bytes so that they share no cache line *****/
+size_t tree_stride( int n ){
+  size_t line=ARENA_ALIGN/sizeof(int);
+  return ((size_t)n+1+line-1)/line*line;
 }
 
-void order_representation(int n, int a[][n], int route[][n])
-{
-    int i, j, k;
-    int order_list[n];
+/***** allocate all buffers of the population in one aligned block **********/
+/***** large blocks are backed by huge pages where the system allows it ******/
+/***** with one decoder scratch block for each thread ***********************/
+void alloc_population( Population *P, int pop, int n, int threads ){
+  size_t cells,ints,off;
+  int *p;
 
-    for (i = 0; i < POPULATION; i++)
-    {
-        for (j = 0; j < n; j++)
-        {
-            order_list[j] = j + 1;
-        }
+  cells=(size_t)pop*n;
+  /* every buffer starts at a multiple of ARENA_ALIGN bytes */
+#define ARENA_INTS(m) ( ((size_t)(m)+ARENA_ALIGN/sizeof(int)-1) / (ARENA_ALIGN/sizeof(int)) * (ARENA_ALIGN/sizeof(int)) )
+  ints=4*ARENA_INTS(cells)+3*ARENA_INTS(2*(size_t)pop)+ARENA_INTS(pop)+2*ARENA_INTS(2*pop*prefix_stride(n))
+    +ARENA_INTS(pop*sizeof(Ranked)/sizeof(int))+threads*tree_stride(n);
+  P->size=ints*sizeof(int);
+  P->base=NULL;
+  P->pop=pop;
+  P->n=n;
+  P->threads=threads;
 
-        for (j = 0; j < n; j++)
-        {
-            k = a[i][j];
-            route[i][j] = order_list[k - 1];
-            copy_array(order_list, n, k);
-        }
-        
+  if(P->size>=HUGE_PAGE){
+    P->size=(P->size+HUGE_PAGE-1)/HUGE_PAGE*HUGE_PAGE;
+    P->kind=ARENA_MMAP;
+#ifdef MAP_HUGETLB
+    P->base=mmap(NULL,P->size,PROT_READ|PROT_WRITE,
+                 MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+    if(P->base==MAP_FAILED) P->base=NULL;
+#endif
+    if(P->base==NULL){
+      P->base=mmap(NULL,P->size,PROT_READ|PROT_WRITE,
+                   MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+      if(P->base==MAP_FAILED) P->base=NULL;
+#ifdef MADV_HUGEPAGE
+      if(P->base!=NULL) madvise(P->base,P->size,MADV_HUGEPAGE);
+#endif
     }
-    
+  }
+  else{
+    P->kind=ARENA_HEAP;
+    if(posix_memalign(&P->base,ARENA_ALIGN,P->size)!=0) P->base=NULL;
+  }
+  if(P->base==NULL){
+    fprintf(stderr,"malloc : not enough memory.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  p=(int*)P->base;
+  off=0;
+  P->gene_a  =p+off; off+=ARENA_INTS(cells);
+  P->gene_b  =p+off; off+=ARENA_INTS(cells);
+  P->route_a =p+off; off+=ARENA_INTS(cells);
+  P->route_b =p+off; off+=ARENA_INTS(cells);
+  P->fitness =(long long*)(p+off); off+=ARENA_INTS(2*(size_t)pop);
+  P->head_a  =(long long*)(p+off); off+=ARENA_INTS(2*pop*prefix_stride(n));
+  P->head_b  =(long long*)(p+off); off+=ARENA_INTS(2*pop*prefix_stride(n));
+  P->dirty   =p+off; off+=ARENA_INTS(2*(size_t)pop);
+  P->polish  =p+off; off+=ARENA_INTS(pop);
+  P->src     =p+off; off+=ARENA_INTS(2*(size_t)pop);
+  P->rank    =(Ranked*)(p+off); off+=ARENA_INTS(pop*sizeof(Ranked)/sizeof(int));
+  P->tree    =p+off;
+#undef ARENA_INTS
 }
 
+/***** release the block of alloc_population() ******************************/
+void free_population( Population *P ){
+  if(P->kind==ARENA_MMAP) munmap(P->base,P->size);
+  else                    free(P->base);
+  P->base=NULL;
+}
 
-void evaluate_route(int n, int route[][n], int *a, TSPdata *tspdata)
-{
-  int i, j, b[n];
+/***** build the distance cache within the memory budget param->distmem ******/
+/***** small instances get a full matrix, large ones band rows ***************/
+void prepare_dist_cache( Param *param, TSPdata *tspdata, DistCache *dc ){
+  int k,l,n,maxd;
+  double minx,maxx,miny,maxy;
+  size_t budget,cells;
 
-  for (i = 0; i < POPULATION; i++)
-  {
-      a[i] = 0;
+  n=tspdata->n;
+  dc->n=n;
+  dc->full32=NULL;
+  dc->full16=NULL;
+  dc->rows=NULL;
+  dc->band=0;
+  dc->xy=(double*)malloc_e(2*(size_t)n*sizeof(double));
+  for(k=0;k<n;k++){
+    dc->xy[2*k]=tspdata->x[k];
+    dc->xy[2*k+1]=tspdata->y[k];
   }
-   
-  for (i = 0; i < POPULATION; i++)
-  {
-    for (j = 0; j < n; j++)
-    {
-      b[j] = route[i][j] - 1;
-    }
-    a[i] = compute_cost(tspdata, b);
+  budget=(size_t)param->distmem*1024*1024;
+
+  /* an upper bound of the distances from the bounding box */
+  minx=maxx=tspdata->x[0];
+  miny=maxy=tspdata->y[0];
+  for(k=1;k<n;k++){
+    if(tspdata->x[k]<minx) minx=tspdata->x[k];
+    if(tspdata->x[k]>maxx) maxx=tspdata->x[k];
+    if(tspdata->y[k]<miny) miny=tspdata->y[k];
+    if(tspdata->y[k]>maxy) maxy=tspdata->y[k];
   }
+  maxd=(int)(sqrt((maxx-minx)*(maxx-minx)+(maxy-miny)*(maxy-miny))+0.5)+1;
 
+  cells=(size_t)n*n;
+  if(maxd<=USHRT_MAX && cells*sizeof(unsigned short)<=budget){
+    dc->mode=DIST_FULL16;
+    dc->full16=(unsigned short*)malloc_e(cells*sizeof(unsigned short));
+    for(k=0;k<n;k++)
+      for(l=0;l<n;l++)
+        dc->full16[(size_t)k*n+l]=(unsigned short)dist(k,l);
+  }
+  else if(maxd>USHRT_MAX && cells*sizeof(int)<=budget){
+    dc->mode=DIST_FULL32;
+    dc->full32=(int*)malloc_e(cells*sizeof(int));
+    for(k=0;k<n;k++)
+      for(l=0;l<n;l++)
+        dc->full32[(size_t)k*n+l]=dist(k,l);
+  }
+  else{
+    dc->mode=DIST_BAND;
+    /* band rows are kept only if the distances fit in 16 bits, and only
+       for the Hilbert numbering: the band is |k-l|<=band, which holds near
+       nodes only when the numbers follow the positions */
+    if(maxd<=USHRT_MAX && param->renumber){
+      dc->band=(int)(budget/((size_t)n*sizeof(unsigned short)));
+      if(dc->band>DIST_BAND_MAX) dc->band=DIST_BAND_MAX;
+      if(dc->band>n-1)           dc->band=n-1;
+    }
+    if(dc->band>0){
+      dc->rows=(unsigned short*)malloc_e((size_t)n*dc->band*sizeof(unsigned short));
+      for(k=0;k<n;k++)
+        for(l=k+1;l<=k+dc->band;l++)
+          dc->rows[(size_t)k*dc->band+(l-k-1)]
+            = (l<n) ? (unsigned short)dist(k,l) : 0;
+    }
+  }
 }
 
-void ranking_selection(int *a, int n, int b[][n], int c[][n]) 
-{
-    int i, j, m, idx, d[POPULATION];
+/***** dist(k,l) from the interleaved coordinates *************************/
+/***** x and y of a node share a cache line; the arithmetic is the same *****/
+static inline int xy_dist( const double *xy, int k, int l ){
+  double dx=xy[2*k]-xy[2*l], dy=xy[2*k+1]-xy[2*l+1];
+  return (int)( sqrt( dx*dx + dy*dy ) + 0.5 );
+}
 
-    for (i = 0; i < POPULATION; i++)
-    {
-        d[i] = a[i];
-    }
-    
+/***** path length kernels: the sum of dist(path[k],path[k+1]) for k<m-1 ****/
+/***** all of them give exactly the same value as the dist() macro ***********/
+long long path_length_scalar( const double *xy, int *path, int m ){
+  int k;
+  long long cost=0;
 
-    for (i = 0; i < POPULATION; i++)
+  for(k=0;k<m-1;k++)
+    cost += xy_dist(xy,path[k],path[k+1]);
+  return cost;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+/* 4 edges per iteration (8 with AVX-512); mul, add, sqrt and truncation are
+   done one by one as in the dist() macro, so no FMA may be used here.
+   The distances are summed in 64-bit lanes; the doubled indices gather x
+   and y of a node from the same line of the interleaved array. */
+__attribute__((target("avx2")))
+long long path_length_avx2( const double *xy, int *path, int m ){
+  int k;
+  long long cost,lane[4];
+  __m256d x0,y0,x1,y1,dx,dy,d;
+  __m128i i0,i1;
+  __m256i sum=_mm256_setzero_si256();
+  const __m256d half=_mm256_set1_pd(0.5);
+
+  for(k=0;k+4<m;k+=4){
+    i0=_mm_slli_epi32(_mm_loadu_si128((__m128i*)(path+k)),1);
+    i1=_mm_slli_epi32(_mm_loadu_si128((__m128i*)(path+k+1)),1);
+    x0=_mm256_i32gather_pd(xy,i0,8);
+    x1=_mm256_i32gather_pd(xy,i1,8);
+    y0=_mm256_i32gather_pd(xy+1,i0,8);
+    y1=_mm256_i32gather_pd(xy+1,i1,8);
+    dx=_mm256_sub_pd(x0,x1);
+    dy=_mm256_sub_pd(y0,y1);
+    dx=_mm256_mul_pd(dx,dx);
+    dy=_mm256_mul_pd(dy,dy);
+    d=_mm256_add_pd(dx,dy);
+    d=_mm256_add_pd(_mm256_sqrt_pd(d),half);
+    sum=_mm256_add_epi64(sum,_mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(d)));
+  }
+  _mm256_storeu_si256((__m256i*)lane,sum);
+  cost=lane[0]+lane[1]+lane[2]+lane[3];
+  for(;k<m-1;k++)
+    cost += xy_dist(xy,path[k],path[k+1]);
+  return cost;
+}
+
+/* AVX-512 implies FMA, so contraction is switched off explicitly */
+__attribute__((target("avx512f"),optimize("fp-contract=off")))
+long long path_length_avx512( const double *xy, int *path, int m ){
+  int k;
+  long long cost;
+  __m512d x0,y0,x1,y1,dx,dy,d;
+  __m256i i0,i1;
+  __m512i sum=_mm512_setzero_si512();
+  const __m512d half=_mm512_set1_pd(0.5);
+
+  for(k=0;k+8<m;k+=8){
+    i0=_mm256_slli_epi32(_mm256_loadu_si256((__m256i*)(path+k)),1);
+    i1=_mm256_slli_epi32(_mm256_loadu_si256((__m256i*)(path+k+1)),1);
+    x0=_mm512_i32gather_pd(i0,xy,8);
+    x1=_mm512_i32gather_pd(i1,xy,8);
+    y0=_mm512_i32gather_pd(i0,xy+1,8);
+    y1=_mm512_i32gather_pd(i1,xy+1,8);
+    dx=_mm512_sub_pd(x0,x1);
+    dy=_mm512_sub_pd(y0,y1);
+    dx=_mm512_mul_pd(dx,dx);
+    dy=_mm512_mul_pd(dy,dy);
+    d=_mm512_add_pd(dx,dy);
+    d=_mm512_add_pd(_mm512_sqrt_pd(d),half);
+    sum=_mm512_add_epi64(sum,_mm512_cvtepi32_epi64(_mm512_cvttpd_epi32(d)));
+  }
+  cost=_mm512_reduce_add_epi64(sum);
+  for(;k<m-1;k++)
+    cost += xy_dist(xy,path[k],path[k+1]);
+  return cost;
+}
+#endif
+
+/***** seconds per edge of a kernel on the path 0, 1, ..., m-1 (the *******/
+/***** order of the search after the renumbering), best of three ************/
+double time_kernel( long long (*f)( const double *xy, int *path, int m ),
+                    const double *xy, int *path, int m ){
+  struct timespec a,b;
+  double t,best=1e30;
+  volatile long long sink=0;
+  int r,k,reps;
+
+  reps=KERNEL_EDGES/m+1;
+  for(r=0;r<3;r++){
+    clock_gettime(CLOCK_MONOTONIC,&a);
+    for(k=0;k<reps;k++) sink+=f(xy,path,m);
+    clock_gettime(CLOCK_MONOTONIC,&b);
+    t=(b.tv_sec-a.tv_sec)+(b.tv_nsec-a.tv_nsec)*1e-9;
+    if(t<best) best=t;
+  }
+  (void)sink;
+  return best/((double)reps*(m-1));
+}
+
+/***** choose the path length kernel which is fastest on this CPU; a ********/
+/***** SIMD kernel is taken only if a short timing shows it is faster *******/
+/***** than the scalar one, as the gathers do not pay off everywhere ********/
+void select_tour_length_kernel( Param *param, DistCache *dc ){
+  dc->path_length=path_length_scalar;
+  dc->kernel="scalar";
+#if defined(__x86_64__) && defined(__GNUC__)
+  if(param->simd && dc->n>=2){
+    int k,m=dc->n<KERNEL_SAMPLE ? dc->n : KERNEL_SAMPLE,*path;
+    double best,t;
+
+    path=(int*)malloc_e(m*sizeof(int));
+    for(k=0;k<m;k++) path[k]=k;
+    best=time_kernel(path_length_scalar,dc->xy,path,m);
+    if(param->debug) printf("path length kernel scalar: %.2f ns/edge\n",best*1e9);
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+      t=time_kernel(path_length_avx2,dc->xy,path,m);
+      if(param->debug) printf("path length kernel avx2: %.2f ns/edge\n",t*1e9);
+      if(t<best){
+        best=t;
+        dc->path_length=path_length_avx2;
+        dc->kernel="avx2";
+      }
+    }
+    if(__builtin_cpu_supports("avx512f")){
+      t=time_kernel(path_length_avx512,dc->xy,path,m);
+      if(param->debug) printf("path length kernel avx512: %.2f ns/edge\n",t*1e9);
+      if(t<best){
+        best=t;
+        dc->path_length=path_length_avx512;
+        dc->kernel="avx512";
+      }
+    }
+    free(path);
+  }
+#endif
+}
+
+/***** random numbers: xoshiro256** streams, one per thread *****************/
+/***** stream s starts 2^128 draws after stream s-1 of the same seed; the ***/
+/***** RNG_LANES lanes of rng_fill() start 2^192 draws apart ****************/
+static __thread Rng rng_state;
+
+static inline unsigned long long rotl64( unsigned long long x, int k ){
+  return (x<<k) | (x>>(64-k));
+}
+
+unsigned long long splitmix64( unsigned long long *x ){
+  unsigned long long z=(*x += 0x9e3779b97f4a7c15ULL);
+  z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+  z=(z^(z>>27))*0x94d049bb133111ebULL;
+  return z^(z>>31);
+}
+
+static inline unsigned long long xoshiro_next( unsigned long long *s ){
+  unsigned long long r=rotl64(s[1]*5,7)*9, t=s[1]<<17;
+
+  s[2]^=s[0]; s[3]^=s[1]; s[1]^=s[2]; s[0]^=s[3];
+  s[2]^=t; s[3]=rotl64(s[3],45);
+  return r;
+}
+
+/***** advance s by 2^128 (poly RNG_JUMP) or 2^192 (RNG_LONG_JUMP) draws ****/
+void xoshiro_jump( unsigned long long *s, const unsigned long long *poly ){
+  unsigned long long t[4]={0,0,0,0};
+  int i,b,k;
+
+  for(i=0;i<4;i++)
+    for(b=0;b<64;b++){
+      if(poly[i] & (1ULL<<b))
+        for(k=0;k<4;k++) t[k]^=s[k];
+      xoshiro_next(s);
+    }
+  memcpy(s,t,sizeof(t));
+}
+
+/***** the calling thread draws from stream "stream" of "seed" from now on **/
+void rng_seed( unsigned long long seed, int stream ){
+  static const unsigned long long jump[4]=
+    {0x180ec6d33cfd0abaULL,0xd5a61266f0c9392cULL,0xa9582618e03fc9aaULL,0x39abdc4529b1661cULL};
+  static const unsigned long long long_jump[4]=
+    {0x76e15d3efefdcbbfULL,0xc5004e441c522fb3ULL,0x77710069854ee241ULL,0x39109bb02acbe635ULL};
+  unsigned long long s[4];
+  int k,l;
+
+  for(k=0;k<4;k++) rng_state.s[k]=splitmix64(&seed);
+  for(k=0;k<stream;k++) xoshiro_jump(rng_state.s,jump);
+  memcpy(s,rng_state.s,sizeof(s));
+  for(l=0;l<RNG_LANES;l++){
+    xoshiro_jump(s,long_jump);
+    for(k=0;k<4;k++) rng_state.lane[k][l]=s[k];
+  }
+}
+
+/***** key of this node among the nodes of the TCP network, which is ******/
+/***** mixed into the seed so that nodes given the same seed draw other ****/
+/***** numbers: a hash of the host name and the port (or, without a port, **/
+/***** the process number); 0 without the network, so that a seed repeats **/
+unsigned long long node_key( Param *param ){
+  char host[256];
+  unsigned long long h=0xcbf29ce484222325ULL;
+  int i;
+
+  if(param->port<=0 && param->peers[0]=='\0') return 0;
+  if(gethostname(host,sizeof(host))!=0) host[0]='\0';
+  host[sizeof(host)-1]='\0';
+  for(i=0;host[i]!='\0';i++) h=(h^(unsigned char)host[i])*0x100000001b3ULL;
+  h^=param->port>0 ? (unsigned long long)param->port : (unsigned long long)getpid()<<16;
+  return splitmix64(&h);
+}
+
+unsigned long long rng_next( void ){
+  return xoshiro_next(rng_state.s);
+}
+
+/***** uniform in 0..k-1 for 0 < k < 2^31 without the bias of % (Lemire's ***/
+/***** method), starting from the 32 random bits x **************************/
+int rng_bounded( unsigned int x, int k ){
+  unsigned long long m=(unsigned long long)x*(unsigned int)k;
+  unsigned int t;
+
+  if((unsigned int)m<(unsigned int)k){
+    t=(0u-(unsigned int)k)%(unsigned int)k;
+    while((unsigned int)m<t)
+      m=(rng_next()>>32)*(unsigned int)k;
+  }
+  return (int)(m>>32);
+}
+
+int rng_below( int k ){
+  return rng_bounded((unsigned int)(rng_next()>>32),k);
+}
+
+/***** random number in [0,1) with 53 bits ***********************************/
+double rng_unit( void ){
+  return (rng_next()>>11)*(1.0/9007199254740992.0);
+}
+
+/***** one step of every lane: 2*RNG_LANES numbers of 32 bits, the low ******/
+/***** halves first *********************************************************/
+void rng_block_scalar( unsigned long long s[4][RNG_LANES], unsigned int *out ){
+  unsigned long long r,t;
+  int l;
+
+  for(l=0;l<RNG_LANES;l++){
+    r=rotl64(s[1][l]*5,7)*9;
+    t=s[1][l]<<17;
+    s[2][l]^=s[0][l]; s[3][l]^=s[1][l]; s[1][l]^=s[2][l]; s[0][l]^=s[3][l];
+    s[2][l]^=t; s[3][l]=rotl64(s[3][l],45);
+    out[l]=(unsigned int)r;
+    out[RNG_LANES+l]=(unsigned int)(r>>32);
+  }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/* the same step with the 4 lanes in one register; *5 and *9 are shifts
+   and adds as AVX2 has no 64-bit multiplication */
+__attribute__((target("avx2")))
+void rng_block_avx2( unsigned long long s[4][RNG_LANES], unsigned int *out ){
+  __m256i s0=_mm256_loadu_si256((__m256i*)s[0]), s1=_mm256_loadu_si256((__m256i*)s[1]);
+  __m256i s2=_mm256_loadu_si256((__m256i*)s[2]), s3=_mm256_loadu_si256((__m256i*)s[3]);
+  __m256i r,t;
+
+  r=_mm256_add_epi64(s1,_mm256_slli_epi64(s1,2));
+  r=_mm256_or_si256(_mm256_slli_epi64(r,7),_mm256_srli_epi64(r,57));
+  r=_mm256_add_epi64(r,_mm256_slli_epi64(r,3));
+  t=_mm256_slli_epi64(s1,17);
+  s2=_mm256_xor_si256(s2,s0);
+  s3=_mm256_xor_si256(s3,s1);
+  s1=_mm256_xor_si256(s1,s2);
+  s0=_mm256_xor_si256(s0,s3);
+  s2=_mm256_xor_si256(s2,t);
+  s3=_mm256_or_si256(_mm256_slli_epi64(s3,45),_mm256_srli_epi64(s3,19));
+  _mm256_storeu_si256((__m256i*)s[0],s0);
+  _mm256_storeu_si256((__m256i*)s[1],s1);
+  _mm256_storeu_si256((__m256i*)s[2],s2);
+  _mm256_storeu_si256((__m256i*)s[3],s3);
+  r=_mm256_permutevar8x32_epi32(r,_mm256_setr_epi32(0,2,4,6,1,3,5,7));
+  _mm256_storeu_si256((__m256i*)out,r);
+}
+#endif
+
+static void (*rng_block)( unsigned long long s[4][RNG_LANES], unsigned int *out )=rng_block_scalar;
+
+/***** choose the lane kernel of rng_fill(); both give the same numbers ******/
+void select_rng_kernel( Param *param ){
+  rng_block=rng_block_scalar;
+#if defined(__x86_64__) && defined(__GNUC__)
+  if(param->simd){
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) rng_block=rng_block_avx2;
+  }
+#endif
+}
+
+/***** m random numbers of 32 bits from the lanes of the calling thread *****/
+void rng_fill( unsigned int *out, int m ){
+  unsigned int tail[2*RNG_LANES];
+  int k;
+
+  for(k=0;k+2*RNG_LANES<=m;k+=2*RNG_LANES)
+    rng_block(rng_state.lane,out+k);
+  if(k<m){
+    rng_block(rng_state.lane,tail);
+    memcpy(out+k,tail,(m-k)*sizeof(unsigned int));
+  }
+}
+
+/***** the lane kernel must give the xoshiro256** numbers of every lane, ****/
+/***** and rng_bounded() the largest value for the largest bits *************/
+void check_rng( void ){
+  unsigned long long a[4][RNG_LANES],s[4],r;
+  unsigned int x[2*RNG_LANES];
+  int k,l,w;
+
+  memcpy(a,rng_state.lane,sizeof(a));
+  for(k=0;k<1000;k++){
+    for(l=0;l<RNG_LANES;l++){
+      for(w=0;w<4;w++) s[w]=a[w][l];
+      r=xoshiro_next(s);
+      rng_block(a,x);
+      if(x[l]!=(unsigned int)r || x[RNG_LANES+l]!=(unsigned int)(r>>32)){
+        fprintf(stderr,"error: random lane %d differs from xoshiro256**.\n",l);
+        exit(EXIT_FAILURE);
+      }
+      for(w=0;w<4;w++) a[w][l]=s[w];
+    }
+  }
+  for(k=1;k<(1<<20);k=2*k+1)
+    if(rng_bounded(0xffffffffu,k)!=k-1){
+      fprintf(stderr,"error: rng_bounded() is wrong for the bound %d.\n",k);
+      exit(EXIT_FAILURE);
+    }
+}
+
+/***** distance between node k and l through the cache ***********************/
+/***** the result is always the same as dist(k,l) ****************************/
+int cached_dist( DistCache *dc, TSPdata *tspdata, int k, int l ){
+  (void)tspdata;
+  if(dc->mode==DIST_FULL16) return dc->full16[(size_t)k*dc->n+l];
+  if(dc->mode==DIST_FULL32) return dc->full32[(size_t)k*dc->n+l];
+  if(k>l){ int t=k; k=l; l=t; }
+  if(l-k<=dc->band && k<l) return dc->rows[(size_t)k*dc->band+(l-k-1)];
+  return xy_dist(dc->xy,k,l);
+}
+
+/***** sum of the edges along path[0..m-1] through the cache ****************/
+/***** a full matrix is read directly, otherwise the kernel computes it ******/
+long long path_cost( DistCache *dc, TSPdata *tspdata, int *path, int m ){
+  int k;
+  long long cost=0;
+
+  if(dc->mode==DIST_BAND)
+    return dc->path_length(dc->xy,path,m);
+  for(k=0;k<m-1;k++)
+    cost += cached_dist(dc,tspdata,path[k],path[k+1]);
+  return cost;
+}
+
+/***** cost of a complete tour (nodes 0..n-1), the same as compute_cost() ***/
+long long route_cost( DistCache *dc, TSPdata *tspdata, int *tour ){
+  int n;
+  n=tspdata->n;
+
+  return path_cost(dc,tspdata,tour,n)+cached_dist(dc,tspdata,tour[n-1],tour[0]);
+}
+
+/***** compare the cache with dist(k,l) **************************************/
+void check_dist_cache( DistCache *dc, TSPdata *tspdata ){
+  int k,l,n,checked=0;
+  n=tspdata->n;
+
+  for(k=0;k<n;k++){
+    /* all pairs for small instances, the band and some others otherwise */
+    for(l=0;l<n;l++){
+      if(dc->mode==DIST_BAND && abs(l-k)>dc->band+1 && l%97!=0) continue;
+      if(cached_dist(dc,tspdata,k,l)!=dist(k,l)){
+        fprintf(stderr,"error: distance cache mismatch at (%d,%d).\n",k,l);
+        exit(EXIT_FAILURE);
+      }
+      checked++;
+    }
+  }
+  printf("distance cache check: mode %d, band %d, %d pairs ok\n",
+         dc->mode,dc->band,checked);
+}
+
+/***** compare the path length kernel with compute_cost() on given routes ***/
+void check_tour_length( DistCache *dc, TSPdata *tspdata, int *route, int num ){
+  int i,n;
+  n=tspdata->n;
+
+  for(i=0;i<num;i++){
+    if(dc->path_length(dc->xy,route+(size_t)i*n,n)+dist(route[(size_t)i*n+n-1],route[(size_t)i*n])
+       !=compute_cost(tspdata,route+(size_t)i*n)){
+      fprintf(stderr,"error: %s kernel mismatch on route %d.\n",dc->kernel,i);
+      exit(EXIT_FAILURE);
+    }
+  }
+  printf("tour length check: %s kernel on %d routes ok\n",dc->kernel,num);
+}
+
+/***** k-d tree over the coordinates ******************************************/
+/***** the subtree of perm[lo..hi-1] is split at mid=(lo+hi)/2 by cut[mid] ****/
+/***** (0: x, 1: y); the left part is <= and the right part >= perm[mid] ******/
+/***** the coordinates are copied in the order of the tree for locality *******/
+void kd_swap( KdTree *kd, int i, int j ){
+  int t;
+  double w;
+
+  t=kd->perm[i]; kd->perm[i]=kd->perm[j]; kd->perm[j]=t;
+  w=kd->px[i];   kd->px[i]=kd->px[j];     kd->px[j]=w;
+  w=kd->py[i];   kd->py[i]=kd->py[j];     kd->py[j]=w;
+}
+
+/***** quickselect: entry k gets the one of rank k-lo in coordinate c ********/
+void kd_select( KdTree *kd, int lo, int hi, int k, double *c ){
+  int i,j;
+  double pivot;
+
+  while(hi-lo>1){
+    pivot=c[(lo+hi)/2];
+    i=lo; j=hi-1;
+    while(i<=j){
+      while(c[i]<pivot) i++;
+      while(c[j]>pivot) j--;
+      if(i<=j){ kd_swap(kd,i,j); i++; j--; }
+    }
+    if(k<=j)      hi=j+1;
+    else if(k>=i) lo=i;
+    else break;
+  }
+}
+
+void kd_build( KdTree *kd, int lo, int hi ){
+  int k,mid;
+  double minx,maxx,miny,maxy;
+
+  while(hi-lo>KD_LEAF){
+    minx=maxx=kd->px[lo];
+    miny=maxy=kd->py[lo];
+    for(k=lo+1;k<hi;k++){
+      if(kd->px[k]<minx) minx=kd->px[k];
+      if(kd->px[k]>maxx) maxx=kd->px[k];
+      if(kd->py[k]<miny) miny=kd->py[k];
+      if(kd->py[k]>maxy) maxy=kd->py[k];
+    }
+    mid=(lo+hi)/2;
+    kd->cut[mid]=(maxy-miny>maxx-minx) ? 1 : 0;
+    kd_select(kd,lo,hi,mid,kd->cut[mid] ? kd->py : kd->px);
+    kd_build(kd,lo,mid);
+    lo=mid+1;
+  }
+}
+
+void prepare_kdtree( TSPdata *tspdata, KdTree *kd ){
+  int k;
+
+  kd->n=tspdata->n;
+  kd->perm=(int*)malloc_e(kd->n*sizeof(int));
+  kd->px=(double*)malloc_e(kd->n*sizeof(double));
+  kd->py=(double*)malloc_e(kd->n*sizeof(double));
+  kd->cut=(unsigned char*)malloc_e(kd->n*sizeof(unsigned char));
+  for(k=0;k<kd->n;k++){
+    kd->perm[k]=k;
+    kd->px[k]=tspdata->x[k];
+    kd->py[k]=tspdata->y[k];
+    kd->cut[k]=0;
+  }
+  kd_build(kd,0,kd->n);
+}
+
+/***** quadrant of the offset (dx,dy) ******************************************/
+/***** 0: dx>=0,dy>=0  1: dx<0,dy>=0  2: dx<0,dy<0  3: dx>=0,dy<0 ************/
+int quadrant_of( double dx, double dy ){
+  if(dy>=0) return (dx>=0) ? 0 : 1;
+  return (dx<0) ? 2 : 3;
+}
+
+/***** can the side "<= s" (side 0) or ">= s" (side 1) of coordinate d hold **/
+/***** points of quadrant q around the query point at coordinate c ***********/
+int quadrant_reachable( int q, int d, int side, double s, double c ){
+  int neg;                      /* the quadrant needs coordinate d < c */
+
+  neg = (d==0) ? (q==1 || q==2) : (q==2 || q==3);
+  if(neg) return side==0 || s<c;
+  return side==1 || s>=c;
+}
+
+/***** insert v with squared distance d2 into the sorted list l **************/
+void knn_insert( KnnQuery *kq, int l, int v, double d2 ){
+  int i,cap=kq->cap[l];
+  int *id=kq->id[l];
+  double *w=kq->d2[l];
+
+  if(cap==0) return;
+  if(kq->num[l]==cap && d2>=w[cap-1]) return;
+  i=(kq->num[l]<cap) ? kq->num[l]++ : cap-1;
+  while(i>0 && w[i-1]>d2){
+    w[i]=w[i-1];
+    id[i]=id[i-1];
+    i--;
+  }
+  w[i]=d2;
+  id[i]=v;
+}
+
+void knn_visit( KdTree *kd, KnnQuery *kq, int i ){
+  double dx,dy,d2;
+
+  if(kd->perm[i]==kq->u) return;
+  dx=kd->px[i]-kq->ux;
+  dy=kd->py[i]-kq->uy;
+  d2=dx*dx+dy*dy;
+  if(kq->num[4]<kq->cap[4] || d2<kq->d2[4][kq->cap[4]-1])
+    knn_insert(kq,4,kd->perm[i],d2);
+  if(kq->cap[0]>0)
+    knn_insert(kq,quadrant_of(dx,dy),kd->perm[i],d2);
+}
+
+/***** may a subtree at squared distance diff on the given side be skipped ***/
+int knn_prune( KnnQuery *kq, int d, int side, double s, double c, double diff ){
+  int q;
+
+  if(kq->num[4]<kq->cap[4] || diff<kq->d2[4][kq->cap[4]-1]) return 0;
+  for(q=0;q<4;q++){
+    if(kq->cap[q]==0 || !quadrant_reachable(q,d,side,s,c)) continue;
+    if(kq->num[q]<kq->cap[q] || diff<kq->d2[q][kq->cap[q]-1]) return 0;
+  }
+  return 1;
+}
+
+void kd_search( KdTree *kd, KnnQuery *kq, int lo, int hi ){
+  int k,mid,d,near;
+  double c,s;
+
+  if(hi<=lo) return;
+  if(hi-lo<=KD_LEAF){
+    for(k=lo;k<hi;k++)
+      knn_visit(kd,kq,k);
+    return;
+  }
+  mid=(lo+hi)/2;
+  d=kd->cut[mid];
+  s=d ? kd->py[mid] : kd->px[mid];
+  c=d ? kq->uy : kq->ux;
+  knn_visit(kd,kq,mid);
+  near=(c<s) ? 0 : 1;
+  if(near==0) kd_search(kd,kq,lo,mid);
+  else        kd_search(kd,kq,mid+1,hi);
+  if(!knn_prune(kq,d,1-near,s,c,(c-s)*(c-s))){
+    if(near==0) kd_search(kd,kq,mid+1,hi);
+    else        kd_search(kd,kq,lo,mid);
+  }
+}
+
+/***** the nearest nodes of u: qk in each quadrant and k of any one **********/
+/***** if u is the entry i of the tree (i>=0), the search starts from its *****/
+/***** leaf and goes up, so the close nodes are found first; otherwise it *****/
+/***** goes down from the root ************************************************/
+void kd_nearest( KdTree *kd, TSPdata *tspdata, KnnQuery *kq, int u, int i, int k, int qk ){
+  int q,d,depth=0,lo=0,hi=kd->n,mid;
+  int plo[64],phi[64];
+  double c,s;
+
+  kq->u=u;
+  kq->ux=tspdata->x[u];
+  kq->uy=tspdata->y[u];
+  for(q=0;q<4;q++){
+    kq->cap[q]=qk;
+    kq->num[q]=0;
+  }
+  kq->cap[4]=k;
+  kq->num[4]=0;
+  if(k<=0) return;
+  if(i<0){
+    kd_search(kd,kq,0,kd->n);
+    return;
+  }
+
+  /* the path from the root to the leaf holding the entry i */
+  while(hi-lo>KD_LEAF){
+    mid=(lo+hi)/2;
+    if(i==mid) break;
+    plo[depth]=lo;
+    phi[depth]=hi;
+    depth++;
+    if(i<mid) hi=mid;
+    else      lo=mid+1;
+  }
+  kd_search(kd,kq,lo,hi);
+  while(depth>0){
+    depth--;
+    lo=plo[depth];
+    hi=phi[depth];
+    mid=(lo+hi)/2;
+    d=kd->cut[mid];
+    s=d ? kd->py[mid] : kd->px[mid];
+    c=d ? kq->uy : kq->ux;
+    knn_visit(kd,kq,mid);
+    /* the other child */
+    if(i<mid){
+      if(!knn_prune(kq,d,1,s,c,(c-s)*(c-s))) kd_search(kd,kq,mid+1,hi);
+    }
+    else{
+      if(!knn_prune(kq,d,0,s,c,(c-s)*(c-s))) kd_search(kd,kq,lo,mid);
+    }
+  }
+}
+
+/***** insert (delta=1) or remove (delta=-1) node v ***********************/
+void kdset_update( KdSet *S, int v, int delta ){
+  int i=S->at[v],lo=0,hi=S->kd->n,mid;
+
+  if(S->alive[i]==(delta>0)) return;
+  S->alive[i]=(delta>0);
+  while(hi-lo>KD_LEAF){
+    mid=(lo+hi)/2;
+    S->count[mid]+=delta;
+    if(i==mid) break;
+    if(i<mid) hi=mid;
+    else      lo=mid+1;
+  }
+}
+
+/***** a set of nodes on the k-d tree, empty (full=0) or with all nodes ****/
+void alloc_kdset( KdSet *S, KdTree *kd, int full ){
+  int i,n=kd->n;
+
+  S->kd=kd;
+  S->at=(int*)malloc_e(n*sizeof(int));
+  S->alive=(char*)malloc_e(n*sizeof(char));
+  S->count=(int*)malloc_e(n*sizeof(int));
+  for(i=0;i<n;i++){
+    S->at[kd->perm[i]]=i;
+    S->alive[i]=0;
+    S->count[i]=0;
+  }
+  if(full)
+    for(i=0;i<n;i++)
+      kdset_update(S,kd->perm[i],1);
+}
+
+void free_kdset( KdSet *S ){
+  free(S->at);
+  free(S->alive);
+  free(S->count);
+}
+
+void kdset_visit( KdSet *S, int i, double ux, double uy, int *best, double *bd ){
+  double dx,dy,d2;
+
+  if(!S->alive[i]) return;
+  dx=S->kd->px[i]-ux;
+  dy=S->kd->py[i]-uy;
+  d2=dx*dx+dy*dy;
+  if(d2<*bd){ *bd=d2; *best=i; }
+}
+
+void kdset_search( KdSet *S, int lo, int hi, double ux, double uy, int *best, double *bd ){
+  KdTree *kd=S->kd;
+  int k,mid;
+  double c,s;
+
+  if(hi<=lo) return;
+  if(hi-lo<=KD_LEAF){
+    for(k=lo;k<hi;k++)
+      kdset_visit(S,k,ux,uy,best,bd);
+    return;
+  }
+  mid=(lo+hi)/2;
+  if(S->count[mid]==0) return;
+  kdset_visit(S,mid,ux,uy,best,bd);
+  s=kd->cut[mid] ? kd->py[mid] : kd->px[mid];
+  c=kd->cut[mid] ? uy : ux;
+  if(c<s){
+    kdset_search(S,lo,mid,ux,uy,best,bd);
+    if((c-s)*(c-s)<*bd) kdset_search(S,mid+1,hi,ux,uy,best,bd);
+  }
+  else{
+    kdset_search(S,mid+1,hi,ux,uy,best,bd);
+    if((c-s)*(c-s)<*bd) kdset_search(S,lo,mid,ux,uy,best,bd);
+  }
+}
+
+/***** the node of the set nearest to node u, -1 if the set is empty *******/
+int kdset_nearest( KdSet *S, TSPdata *tspdata, int u ){
+  int best=-1;
+  double bd=HUGE_VAL;
+
+  kdset_search(S,0,S->kd->n,tspdata->x[u],tspdata->y[u],&best,&bd);
+  return best<0 ? -1 : S->kd->perm[best];
+}
+
+/***** neighbour lists of all nodes in CSR layout ******************************/
+/***** K nearest nodes, or quadrant-balanced: K/4 nearest in each quadrant ****/
+/***** filled up with the nearest others; each list is sorted by distance *****/
+/***** the queries are made in the order of the tree for cache locality *******/
+void prepare_neighbors( Param *param, TSPdata *tspdata,
+                        KdTree *kd, Neighbors *nb ){
+  int i,j,u,k,q,K,qk,num,nq,n;
+  int *list;
+  double *d2;
+  KnnQuery kq;
+
+  n=tspdata->n;
+  K=param->neighbors;
+  if(K>n-1) K=n-1;
+  if(K<0)   K=0;
+  qk=param->quadrant ? K/4 : 0;
+  nb->n=n;
+  nb->k=K;
+  nb->start=(int*)malloc_e((n+1)*sizeof(int));
+  nb->adj=(int*)malloc_e(((size_t)n*K+1)*sizeof(int));
+  nb->len=(int*)malloc_e(((size_t)n*K+1)*sizeof(int));
+  for(q=0;q<5;q++){
+    kq.id[q]=(int*)malloc_e((K+1)*sizeof(int));
+    kq.d2[q]=(double*)malloc_e((K+1)*sizeof(double));
+  }
+  list=(int*)malloc_e((K+1)*sizeof(int));
+  d2=(double*)malloc_e((K+1)*sizeof(double));
+
+  /* every list has min(K,n-1) entries */
+  nb->start[0]=0;
+  for(u=0;u<n;u++)
+    nb->start[u+1]=nb->start[u]+K;
+
+  for(i=0;i<n;i++){
+    u=kd->perm[i];
+    kd_nearest(kd,tspdata,&kq,u,i,K,qk);
+    num=0;
+    for(q=0;q<4;q++)
+      for(k=0;k<kq.num[q];k++){
+        list[num]=kq.id[q][k]; d2[num]=kq.d2[q][k]; num++;
+      }
+    /* filled up with the nearest ones not taken yet */
+    nq=num;
+    for(k=0;k<kq.num[4] && num<K;k++){
+      for(j=0;j<nq && list[j]!=kq.id[4][k];j++);
+      if(j<nq) continue;
+      list[num]=kq.id[4][k]; d2[num]=kq.d2[4][k]; num++;
+    }
+    /* sort by the distance, insertion sort as the lists are short */
+    for(k=1;k<num;k++){
+      int v=list[k],j=k;
+      double w=d2[k];
+      while(j>0 && d2[j-1]>w){ list[j]=list[j-1]; d2[j]=d2[j-1]; j--; }
+      list[j]=v; d2[j]=w;
+    }
+    /* the same value as dist(u,v) since d2 is summed in the same order */
+    for(k=0;k<num;k++){
+      nb->adj[nb->start[u]+k]=list[k];
+      nb->len[nb->start[u]+k]=(int)(sqrt(d2[k])+0.5);
+    }
+  }
+
+  for(q=0;q<5;q++){
+    free(kq.id[q]);
+    free(kq.d2[q]);
+  }
+  free(list);
+  free(d2);
+}
+
+/***** compare the k-d tree lists with a brute force search on some nodes ****/
+void check_neighbors( TSPdata *tspdata, Neighbors *nb, int quadrant ){
+  int u,v,k,n,step,closer,checked=0;
+  double dk,dv;
+  n=tspdata->n;
+  step=(n>2000) ? n/1000 : 1;
+
+  for(u=0;u<n;u+=step){
+    int num=nb->start[u+1]-nb->start[u];
+    if(num!=nb->k){
+      fprintf(stderr,"error: neighbor list of %d has %d entries.\n",u,num);
+      exit(EXIT_FAILURE);
+    }
+    /* neither u itself nor the same node twice */
+    for(k=nb->start[u];k<nb->start[u+1];k++){
+      for(v=nb->start[u];v<k && nb->adj[v]!=nb->adj[k];v++);
+      if(nb->adj[k]==u || v<k){
+        fprintf(stderr,"error: neighbor list of %d has a wrong entry.\n",u);
+        exit(EXIT_FAILURE);
+      }
+    }
+    if(quadrant || num==0) { checked++; continue; }
+    /* no node outside the list may be closer than the last one */
+    k=nb->adj[nb->start[u+1]-1];
+    dk=(tspdata->x[k]-tspdata->x[u])*(tspdata->x[k]-tspdata->x[u])
+      +(tspdata->y[k]-tspdata->y[u])*(tspdata->y[k]-tspdata->y[u]);
+    closer=0;
+    for(v=0;v<n;v++){
+      if(v==u) continue;
+      dv=(tspdata->x[v]-tspdata->x[u])*(tspdata->x[v]-tspdata->x[u])
+        +(tspdata->y[v]-tspdata->y[u])*(tspdata->y[v]-tspdata->y[u]);
+      if(dv<dk) closer++;
+    }
+    if(closer>num-1){
+      fprintf(stderr,"error: neighbor list of %d misses closer nodes.\n",u);
+      exit(EXIT_FAILURE);
+    }
+    checked++;
+  }
+  printf("neighbor check: %d lists of %d nodes ok\n",checked,nb->k);
+}
+
+/***** two-level doubly-linked list of a tour ******************************/
+void alloc_two_level( TwoLevel *tl, int n ){
+  int segs=(int)sqrt((double)n);
+
+  if(segs<2) segs=2;
+  tl->n=n;
+  tl->segs=segs;
+  tl->nx=(int*)malloc_e(n*sizeof(int));
+  tl->pv=(int*)malloc_e(n*sizeof(int));
+  tl->seq=(int*)malloc_e(n*sizeof(int));
+  tl->par=(int*)malloc_e(n*sizeof(int));
+  tl->first=(int*)malloc_e(segs*sizeof(int));
+  tl->last=(int*)malloc_e(segs*sizeof(int));
+  tl->size=(int*)malloc_e(segs*sizeof(int));
+  tl->rev=(char*)malloc_e(segs*sizeof(char));
+  tl->rank=(int*)malloc_e(segs*sizeof(int));
+  tl->snext=(int*)malloc_e(segs*sizeof(int));
+  tl->sprev=(int*)malloc_e(segs*sizeof(int));
+}
+
+void free_two_level( TwoLevel *tl ){
+  free(tl->nx);
+  free(tl->pv);
+  free(tl->seq);
+  free(tl->par);
+  free(tl->first);
+  free(tl->last);
+  free(tl->size);
+  free(tl->rev);
+  free(tl->rank);
+  free(tl->snext);
+  free(tl->sprev);
+}
+
+/***** build the list from tour[0..n-1] with segments of equal size *********/
+void tl_load( TwoLevel *tl, int *tour ){
+  int n=tl->n,segs=tl->segs,i,k,lo,hi;
+
+  for(i=0;i<segs;i++){
+    lo=(int)((long long)i*n/segs);
+    hi=(int)((long long)(i+1)*n/segs);
+    for(k=lo;k<hi;k++){
+      tl->nx[tour[k]]=tour[k+1==n ? 0 : k+1];
+      tl->pv[tour[k]]=tour[k==0 ? n-1 : k-1];
+      tl->seq[tour[k]]=k-lo;
+      tl->par[tour[k]]=i;
+    }
+    tl->first[i]=tour[lo];
+    tl->last[i]=tour[hi-1];
+    tl->size[i]=hi-lo;
+    tl->rev[i]=0;
+    tl->rank[i]=i;
+    tl->snext[i]=(i+1==segs) ? 0 : i+1;
+    tl->sprev[i]=(i==0) ? segs-1 : i-1;
+  }
+}
+
+int tl_succ( TwoLevel *tl, int v ){
+  return tl->rev[tl->par[v]] ? tl->pv[v] : tl->nx[v];
+}
+
+int tl_pred( TwoLevel *tl, int v ){
+  return tl->rev[tl->par[v]] ? tl->nx[v] : tl->pv[v];
+}
+
+/***** write the tour starting at node v into tour[0..n-1] ******************/
+void tl_store( TwoLevel *tl, int *tour, int v ){
+  int k;
+
+  for(k=0;k<tl->n;k++){
+    tour[k]=v;
+    v=tl_succ(tl,v);
+  }
+}
+
+/***** the first and the last node of segment s in the tour *****************/
+int tl_head( TwoLevel *tl, int s ){
+  return tl->rev[s] ? tl->last[s] : tl->first[s];
+}
+
+int tl_tail( TwoLevel *tl, int s ){
+  return tl->rev[s] ? tl->first[s] : tl->last[s];
+}
+
+void tl_set_succ( TwoLevel *tl, int v, int w ){
+  if(tl->rev[tl->par[v]]) tl->pv[v]=w;
+  else                    tl->nx[v]=w;
+}
+
+void tl_set_pred( TwoLevel *tl, int v, int w ){
+  if(tl->rev[tl->par[v]]) tl->nx[v]=w;
+  else                    tl->pv[v]=w;
+}
+
+/***** position of v within its segment in the direction of the tour ********/
+int tl_tpos( TwoLevel *tl, int v ){
+  return tl->rev[tl->par[v]] ? -tl->seq[v] : tl->seq[v];
+}
+
+/***** is b on the path from a to c in the direction of the tour ************/
+int tl_between( TwoLevel *tl, int a, int b, int c ){
+  int pa=tl->par[a],segs=tl->segs;
+  int ib,ic,kb,kc;
+
+  ib=tl->rank[tl->par[b]]-tl->rank[pa];
+  if(ib<0) ib+=segs;
+  if(ib==0 && tl_tpos(tl,b)<tl_tpos(tl,a)) ib=segs;
+  ic=tl->rank[tl->par[c]]-tl->rank[pa];
+  if(ic<0) ic+=segs;
+  if(ic==0 && tl_tpos(tl,c)<tl_tpos(tl,a)) ic=segs;
+  if(ib!=ic) return ib<ic;
+  kb=tl_tpos(tl,b);
+  kc=tl_tpos(tl,c);
+  return kb<=kc;
+}
+
+/***** renumber the nodes of segment s from 0 *******************************/
+void tl_renumber( TwoLevel *tl, int s ){
+  int v=tl->first[s],k;
+
+  for(k=0;k<tl->size[s];k++){
+    tl->seq[v]=k;
+    v=tl->nx[v];
+  }
+}
+
+/***** move m nodes starting at x (in the tour order) from their segment ****/
+/***** to the tail (at_tail=1) or the head of the adjacent segment t; the ***/
+/***** tour itself does not change *****************************************/
+void tl_move_nodes( TwoLevel *tl, int x, int m, int t, int at_tail ){
+  int s=tl->par[x],i,y,base,step,tmp;
+
+  if(at_tail){
+    if(tl->rev[t]) { base=tl->seq[tl->first[t]]-1; step=-1; }
+    else           { base=tl->seq[tl->last[t]]+1;  step=1; }
+  }
+  else{
+    if(tl->rev[t]) { base=tl->seq[tl->last[t]]+m;  step=-1; }
+    else           { base=tl->seq[tl->first[t]]-m; step=1; }
+  }
+  for(i=0;i<m;i++){
+    y=tl_succ(tl,x);
+    if(tl->rev[s]!=tl->rev[t]){
+      tmp=tl->nx[x]; tl->nx[x]=tl->pv[x]; tl->pv[x]=tmp;
+    }
+    tl->par[x]=t;
+    tl->seq[x]=base+step*i;
+    if(i==0 && !at_tail){
+      if(tl->rev[t]) tl->last[t]=x;
+      else           tl->first[t]=x;
+    }
+    if(i==m-1 && at_tail){
+      if(tl->rev[t]) tl->first[t]=x;
+      else           tl->last[t]=x;
+    }
+    x=y;
+  }
+  tl->size[s]-=m;
+  tl->size[t]+=m;
+  if(abs(tl->seq[tl->first[t]])>(1<<29) || abs(tl->seq[tl->last[t]])>(1<<29))
+    tl_renumber(tl,t);
+}
+
+/***** make b the head of its segment by moving the shorter part of the *****/
+/***** segment into the adjacent segment ***********************************/
+void tl_split_before( TwoLevel *tl, int b ){
+  int s=tl->par[b],h=tl_head(tl,s),na,p;
+
+  if(b==h) return;
+  na=abs(tl->seq[b]-tl->seq[h]);
+  if(2*na<=tl->size[s]){
+    tl_move_nodes(tl,h,na,tl->sprev[s],1);
+    if(tl->rev[s]) tl->last[s]=b;
+    else           tl->first[s]=b;
+  }
+  else{
+    p=tl_pred(tl,b);
+    tl_move_nodes(tl,b,tl->size[s]-na,tl->snext[s],0);
+    if(tl->rev[s]) tl->first[s]=p;
+    else           tl->last[s]=p;
+  }
+}
+
+/***** make c the tail of its segment in the same way; the head b of ********/
+/***** another segment stays a head ****************************************/
+void tl_split_after( TwoLevel *tl, int c, int b ){
+  int s=tl->par[c],h=tl_head(tl,s),nc,q;
+
+  if(c==tl_tail(tl,s)) return;
+  nc=abs(tl->seq[c]-tl->seq[h])+1;
+  q=tl_succ(tl,c);
+  if(2*nc>=tl->size[s] && tl->snext[s]!=tl->par[b]){
+    tl_move_nodes(tl,q,tl->size[s]-nc,tl->snext[s],0);
+    if(tl->rev[s]) tl->first[s]=c;
+    else           tl->last[s]=c;
+  }
+  else{
+    tl_move_nodes(tl,h,nc,tl->sprev[s],1);
+    if(tl->rev[s]) tl->last[s]=q;
+    else           tl->first[s]=q;
+  }
+}
+
+/***** reverse the path b..c that lies within one segment ******************/
+void tl_reverse_nodes( TwoLevel *tl, int b, int c ){
+  int s=tl->par[b],u,w,p,q,x,y,lo,hi;
+
+  if(tl->rev[s]) { u=c; w=b; }
+  else           { u=b; w=c; }
+  p=tl->pv[u];
+  q=tl->nx[w];
+  lo=tl->seq[u];
+  hi=tl->seq[w];
+  for(x=u;;x=y){
+    y=tl->nx[x];
+    tl->nx[x]=tl->pv[x];
+    tl->pv[x]=y;
+    tl->seq[x]=lo+hi-tl->seq[x];
+    if(x==w) break;
+  }
+  tl->pv[w]=p;
+  tl->nx[u]=q;
+  if(tl->nx[p]==u) tl->nx[p]=w;
+  else             tl->pv[p]=w;
+  if(tl->pv[q]==w) tl->pv[q]=u;
+  else             tl->nx[q]=u;
+  if(tl->first[s]==u) tl->first[s]=w;
+  if(tl->last[s]==w)  tl->last[s]=u;
+}
+
+/***** reverse the segments P..Q (in the tour order) as a whole ************/
+void tl_reverse_segments( TwoLevel *tl, int P, int Q ){
+  int before=tl->sprev[P],after=tl->snext[Q];
+  int a=tl_tail(tl,before),d=tl_head(tl,after),b=tl_head(tl,P),c=tl_tail(tl,Q);
+  int k,i,x,y,t;
+
+  k=tl->rank[Q]-tl->rank[P];
+  if(k<0) k+=tl->segs;
+  k++;
+  for(i=0,x=P,y=Q;i<k/2;i++,x=tl->snext[x],y=tl->sprev[y]){
+    t=tl->rank[x]; tl->rank[x]=tl->rank[y]; tl->rank[y]=t;
+  }
+  for(i=0,x=P;i<k;i++,x=y){
+    y=tl->snext[x];
+    tl->rev[x]^=1;
+    tl->snext[x]=tl->sprev[x];
+    tl->sprev[x]=y;
+  }
+  tl->snext[before]=Q;
+  tl->sprev[Q]=before;
+  tl->snext[P]=after;
+  tl->sprev[after]=P;
+  tl_set_succ(tl,a,c);
+  tl_set_pred(tl,c,a);
+  tl_set_succ(tl,b,d);
+  tl_set_pred(tl,d,b);
+}
+
+/***** reverse the path b..c of the tour (or the rest of the tour, which ****/
+/***** gives the same cycle) ***********************************************/
+void tl_flip( TwoLevel *tl, int b, int c ){
+  int P,Q,k;
+
+  if(tl->par[b]==tl->par[c] && tl_tpos(tl,b)<=tl_tpos(tl,c)){
+    tl_reverse_nodes(tl,b,c);
+    return;
+  }
+  tl_split_before(tl,b);
+  if(tl->par[b]==tl->par[c] && tl_tpos(tl,b)<=tl_tpos(tl,c)){
+    tl_reverse_nodes(tl,b,c);
+    return;
+  }
+  tl_split_after(tl,c,b);
+  P=tl->par[b];
+  Q=tl->par[c];
+  k=tl->rank[Q]-tl->rank[P];
+  if(k<0) k+=tl->segs;
+  if(2*(k+1)>tl->segs) tl_reverse_segments(tl,tl->snext[Q],tl->sprev[P]);
+  else                 tl_reverse_segments(tl,P,Q);
+}
+
+/***** local search on an array tour with a position index or on a *********/
+/***** two-level list (twolevel=1, at least TL_MIN nodes) ******************/
+void alloc_local_search( LocalSearch *ls, int n, int twolevel ){
+  int v;
+
+  ls->n=n;
+  ls->twolevel=(twolevel && n>=TL_MIN);
+  if(ls->twolevel) alloc_two_level(&ls->tl,n);
+  ls->tour=NULL;
+  ls->pos=(int*)malloc_e(n*sizeof(int));
+  ls->queue=(int*)malloc_e(n*sizeof(int));
+  ls->active=(char*)malloc_e(n*sizeof(char));
+  for(v=0;v<n;v++) ls->active[v]=0;
+  ls->qhead=0;
+  ls->qnum=0;
+  ls->moves=0;
+  ls->or_moves=0;
+  ls->lk_moves=0;
+  ls->time=0;
+  ls->deadline=0;
+}
+
+void free_local_search( LocalSearch *ls ){
+  if(ls->twolevel) free_two_level(&ls->tl);
+  free(ls->pos);
+  free(ls->queue);
+  free(ls->active);
+}
+
+/***** turn the don't-look bit of v off by putting it into the queue ********/
+void ls_push( LocalSearch *ls, int v ){
+  int t;
+
+  if(ls->active[v]) return;
+  ls->active[v]=1;
+  t=ls->qhead+ls->qnum;
+  if(t>=ls->n) t-=ls->n;
+  ls->queue[t]=v;
+  ls->qnum++;
+}
+
+int ls_pop( LocalSearch *ls ){
+  int v=ls->queue[ls->qhead];
+
+  ls->qhead++;
+  if(ls->qhead==ls->n) ls->qhead=0;
+  ls->qnum--;
+  ls->active[v]=0;
+  return v;
+}
+
+/***** work on tour; the nodes from position "from" on (and the first one) ***/
+/***** are queued, the others keep their don't-look bits on *****************/
+void ls_load( LocalSearch *ls, int *tour, int from ){
+  int k,n=ls->n;
+
+  ls->tour=tour;
+  if(ls->twolevel) tl_load(&ls->tl,tour);
+  else
+    for(k=0;k<n;k++)
+      ls->pos[tour[k]]=k;
+  while(ls->qnum>0) ls_pop(ls);
+  ls->qhead=0;
+  if(from>0) from--;
+  ls_push(ls,tour[0]);
+  for(k=from;k<n;k++)
+    ls_push(ls,tour[k]);
+}
+
+/***** write the tour of the two-level list back to ls->tour ***************/
+void ls_store( LocalSearch *ls ){
+  if(ls->twolevel) tl_store(&ls->tl,ls->tour,ls->tour[0]);
+}
+
+int ls_succ( LocalSearch *ls, int v ){
+  int p;
+
+  if(ls->twolevel) return tl_succ(&ls->tl,v);
+  p=ls->pos[v]+1;
+  return ls->tour[p==ls->n ? 0 : p];
+}
+
+int ls_pred( LocalSearch *ls, int v ){
+  int p;
+
+  if(ls->twolevel) return tl_pred(&ls->tl,v);
+  p=ls->pos[v];
+  return ls->tour[p==0 ? ls->n-1 : p-1];
+}
+
+/***** reverse the path tour[i..j] (positions, cyclic) ***********************/
+/***** the shorter of the path and the rest of the tour is reversed *********/
+void ls_reverse( LocalSearch *ls, int i, int j ){
+  int n=ls->n,len,t,k;
+  int *tour=ls->tour,*pos=ls->pos;
+
+  len=j-i;
+  if(len<0) len+=n;
+  len++;
+  if(2*len>n){
+    /* reversing the rest gives the same cycle */
+    t=i; i=j+1; j=t-1;
+    if(i>=n) i-=n;
+    if(j<0)  j+=n;
+    len=n-len;
+  }
+  for(k=0;k<len/2;k++){
+    t=tour[i];
+    tour[i]=tour[j];
+    tour[j]=t;
+    pos[tour[i]]=i;
+    pos[tour[j]]=j;
+    if(++i==n) i=0;
+    if(--j<0)  j=n-1;
+  }
+}
+
+/***** 2-opt move removing the edges {x1,x2},{y1,y2} and adding {x1,y1}, ****/
+/***** {x2,y2}; x2 must follow x1 in the same direction as y2 follows y1 *****/
+void ls_move2( LocalSearch *ls, int x1, int x2, int y1, int y2 ){
+  if(ls->twolevel){
+    if(ls_succ(ls,x1)==x2) tl_flip(&ls->tl,x2,y1);
+    else                   tl_flip(&ls->tl,x1,y2);
+  }
+  else if(ls_succ(ls,x1)==x2) ls_reverse(ls,ls->pos[x2],ls->pos[y1]);
+  else                   ls_reverse(ls,ls->pos[x1],ls->pos[y2]);
+}
+
+/***** first improving 2-opt move around node a through its neighbours ******/
+/***** returns the gain (0 if there is none) ********************************/
+long long two_opt_node( LocalSearch *ls, TSPdata *tspdata, DistCache *dc,
+                        Neighbors *nb, int a ){
+  int k,b,c,d,dir,d_ab,d_ac;
+  long long gain;
+
+  for(dir=0;dir<2;dir++){
+    b=dir ? ls_pred(ls,a) : ls_succ(ls,a);
+    d_ab=cached_dist(dc,tspdata,a,b);
+    for(k=nb->start[a];k<nb->start[a+1];k++){
+      d_ac=nb->len[k];
+      if(d_ac>=d_ab) break;
+      c=nb->adj[k];
+      d=dir ? ls_pred(ls,c) : ls_succ(ls,c);
+      if(c==b || d==a) continue;
+      gain=(long long)d_ab+cached_dist(dc,tspdata,c,d)-d_ac-cached_dist(dc,tspdata,b,d);
+      if(gain<=0) continue;
+      /* (a,b),(c,d) -> (a,c),(b,d) */
+      ls_move2(ls,a,b,c,d);
+      ls_push(ls,a);
+      ls_push(ls,b);
+      ls_push(ls,c);
+      ls_push(ls,d);
+      ls->moves++;
+      return gain;
+    }
+  }
+  return 0;
+}
+
+/***** is node v in the segment s1..s2 ************************************/
+int ls_in_segment( LocalSearch *ls, int s1, int s2, int v ){
+  int k,l;
+
+  if(ls->twolevel) return tl_between(&ls->tl,s1,v,s2);
+  k=ls->pos[v]-ls->pos[s1];
+  if(k<0) k+=ls->n;
+  l=ls->pos[s2]-ls->pos[s1];
+  if(l<0) l+=ls->n;
+  return k<=l;
+}
+
+/***** move the segment s1..s2 (p before, q after it) between u and v=succ(u) */
+/***** reversed: u-s2..s1-v, otherwise u-s1..s2-v; done by 2-opt moves ******/
+void ls_move_segment( LocalSearch *ls, int p, int s1, int s2, int q, int u, int v, int rev ){
+  ls_move2(ls,p,s1,u,v);        /* p u .. q s2..s1 v */
+  ls_move2(ls,p,u,q,s2);        /* p q .. u s2..s1 v */
+  if(!rev && s1!=s2)
+    ls_move2(ls,u,s2,s1,v);     /* p q .. u s1..s2 v */
+}
+
+/***** first improving Or-opt move of a segment of 1..OROPT_LEN nodes *******/
+/***** with node a at one end; the insertion points are the neighbours of ***/
+/***** both ends of the segment and both orientations are tried ************/
+long long or_opt_node( LocalSearch *ls, TSPdata *tspdata, DistCache *dc,
+                       Neighbors *nb, int a ){
+  int len,side,e,t,k,s1,s2,p,q,x,c,u,v,rev,add;
+  long long g,gain;
+
+  if(ls->n<OROPT_LEN+5) return 0;
+  for(len=1;len<=OROPT_LEN;len++){
+    for(side=0;side<2;side++){
+      if(len==1 && side==1) break;
+      /* the segment s1..s2 in the direction of the tour */
+      s1=s2=a;
+      for(k=1;k<len;k++){
+        if(side==0) s2=ls_succ(ls,s2);
+        else        s1=ls_pred(ls,s1);
+      }
+      p=ls_pred(ls,s1);
+      q=ls_succ(ls,s2);
+      g=(long long)cached_dist(dc,tspdata,p,s1)+cached_dist(dc,tspdata,s2,q)
+        -cached_dist(dc,tspdata,p,q);
+      if(g<=0) continue;
+      for(e=0;e<2;e++){
+        x = e ? s2 : s1;
+        for(k=nb->start[x];k<nb->start[x+1];k++){
+          if(g-nb->len[k]<=0) break;
+          c=nb->adj[k];
+          if(ls_in_segment(ls,s1,s2,c)) continue;
+          for(t=0;t<2;t++){
+            /* x gets adjacent to c, which is u (t=0) or v (t=1) */
+            if(t==0){ u=c; v=ls_succ(ls,c); }
+            else    { u=ls_pred(ls,c); v=c; }
+            if(u==q || v==p || ls_in_segment(ls,s1,s2,u) || ls_in_segment(ls,s1,s2,v))
+              continue;
+            rev = (x==s1) ? (t==1) : (t==0);
+            if(rev) add=cached_dist(dc,tspdata,u,s2)+cached_dist(dc,tspdata,s1,v);
+            else    add=cached_dist(dc,tspdata,u,s1)+cached_dist(dc,tspdata,s2,v);
+            gain=g+cached_dist(dc,tspdata,u,v)-add;
+            if(gain<=0) continue;
+            ls_move_segment(ls,p,s1,s2,q,u,v,rev);
+            ls_push(ls,p);
+            ls_push(ls,q);
+            ls_push(ls,s1);
+            ls_push(ls,s2);
+            ls_push(ls,u);
+            ls_push(ls,v);
+            ls->or_moves++;
+            return gain;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/***** is {u,v} one of the edges e[0..m-1] *********************************/
+int lk_has_edge( int e[][2], int m, int u, int v ){
+  int i;
+  for(i=0;i<m;i++)
+    if((e[i][0]==u && e[i][1]==v) || (e[i][0]==v && e[i][1]==u)) return 1;
+  return 0;
+}
+
+/***** variable-depth move starting with the edge {t1,t2}: each step ********/
+/***** removes {t1,t2},{t3,t4}, adds {t2,t3},{t1,t4} and goes on with t2=t4 **/
+/***** as long as the partial gain stays positive (Lin-Kernighan rule); *****/
+/***** LK_BREADTH alternatives are tried for the first t3, the best one *****/
+/***** afterwards; the steps after the best closed tour are undone; a ******/
+/***** chain has at most LK_DEPTH steps, so the deadline is left to the ******/
+/***** caller improve_tour() ************************************************/
+long long lk_chain( LocalSearch *ls, TSPdata *tspdata, DistCache *dc,
+                    Neighbors *nb, int t1, int t2 ){
+  int step[LK_DEPTH][3];        /* t2,t3,t4 of each step */
+  int added[LK_DEPTH][2];       /* the edges {t2,t3} added so far */
+  int removed[LK_DEPTH+1][2];   /* the edges {t1,t2},{t3,t4} removed so far */
+  int first,depth,best_depth,k,c3,c4,b3,b4,fwd,i,u;
+  long long g,g1,val,bval,best;
+
+  for(first=nb->start[t2];first<nb->start[t2+1] && first<nb->start[t2]+LK_BREADTH;first++){
+    u=t2;
+    g=cached_dist(dc,tspdata,t1,u);
+    removed[0][0]=t1; removed[0][1]=u;
+    depth=best_depth=0;
+    best=0;
+    while(depth<LK_DEPTH){
+      fwd=(ls_succ(ls,u)==t1);
+      b3=b4=-1;
+      bval=0;
+      for(k=(depth==0 ? first : nb->start[u]);k<nb->start[u+1];k++){
+        g1=g-nb->len[k];
+        if(g1<=0) break;
+        c3=nb->adj[k];
+        c4=fwd ? ls_succ(ls,c3) : ls_pred(ls,c3);
+        if(c3!=t1 && c4!=t1 && c3!=ls_succ(ls,u) && c3!=ls_pred(ls,u)
+           && !lk_has_edge(added,depth,c3,c4) && !lk_has_edge(removed,depth+1,u,c3)){
+          val=g1+cached_dist(dc,tspdata,c3,c4);
+          if(b3<0 || val>bval){ b3=c3; b4=c4; bval=val; }
+        }
+        if(depth==0) break;
+      }
+      if(b3<0) break;
+      /* (u,t1),(t3,t4) -> (u,t3),(t1,t4) */
+      ls_move2(ls,u,t1,b3,b4);
+      step[depth][0]=u; step[depth][1]=b3; step[depth][2]=b4;
+      added[depth][0]=u; added[depth][1]=b3;
+      removed[depth+1][0]=b3; removed[depth+1][1]=b4;
+      depth++;
+      g=bval;
+      if(g-cached_dist(dc,tspdata,b4,t1)>best){
+        best=g-cached_dist(dc,tspdata,b4,t1);
+        best_depth=depth;
+      }
+      u=b4;
+    }
+    while(depth>best_depth){
+      depth--;
+      ls_move2(ls,step[depth][0],step[depth][1],t1,step[depth][2]);
+    }
+    if(best>0){
+      ls_push(ls,t1);
+      for(i=0;i<best_depth;i++){
+        ls_push(ls,step[i][0]);
+        ls_push(ls,step[i][1]);
+        ls_push(ls,step[i][2]);
+      }
+      ls->lk_moves++;
+      return best;
+    }
+  }
+  return 0;
+}
+
+/***** first improving variable-depth move from node a in both directions **/
+long long lk_node( LocalSearch *ls, TSPdata *tspdata, DistCache *dc,
+                   Neighbors *nb, int a ){
+  long long gain;
+
+  if(ls->n<8) return 0;
+  gain=lk_chain(ls,tspdata,dc,nb,a,ls_succ(ls,a));
+  if(gain==0) gain=lk_chain(ls,tspdata,dc,nb,a,ls_pred(ls,a));
+  return gain;
+}
+
+/***** apply random 2-opt moves to an array tour and a two-level list and *****/
+/***** compare the neighbours and the between queries of both ***************/
+void check_two_level( int n ){
+  LocalSearch arr,lst;
+  int *tour,*tour2,k,v,a,b,c,d,x,y,z,same,moves=0;
+
+  if(n<TL_MIN) return;
+  alloc_local_search(&arr,n,0);
+  alloc_local_search(&lst,n,1);
+  tour=(int*)malloc_e(n*sizeof(int));
+  for(k=0;k<n;k++) tour[k]=k;
+  for(k=n-1;k>0;k--){
+    v=rng_below(k+1);
+    a=tour[k]; tour[k]=tour[v]; tour[v]=a;
+  }
+  tour2=(int*)malloc_e(n*sizeof(int));
+  memcpy(tour2,tour,n*sizeof(int));
+  ls_load(&arr,tour,n);
+  ls_load(&lst,tour2,n);
+  for(k=0;k<20000;k++){
+    a=rng_below(n);
+    c=rng_below(n);
+    /* short moves within one segment are the common case */
+    if(k%2) for(v=rng_below(2*lst.tl.segs);v>0;v--) c=ls_succ(&arr,c);
+    b=ls_succ(&arr,a);
+    d=ls_succ(&arr,c);
+    if(c==a || c==b || d==a) continue;
+    ls_move2(&arr,a,b,c,d);
+    ls_move2(&lst,a,b,c,d);
+    moves++;
+    if(k%100!=0) continue;
+    same=(ls_succ(&lst,a)==ls_succ(&arr,a));
+    for(v=0;v<n;v++){
+      if(same ? (ls_succ(&lst,v)!=ls_succ(&arr,v) || ls_pred(&lst,v)!=ls_pred(&arr,v))
+              : (ls_succ(&lst,v)!=ls_pred(&arr,v) || ls_pred(&lst,v)!=ls_succ(&arr,v))){
+        fprintf(stderr,"error: two-level list differs from the array at node %d.\n",v);
+        exit(EXIT_FAILURE);
+      }
+    }
+    for(v=0;v<100;v++){
+      x=rng_below(n); y=rng_below(n); z=rng_below(n);
+      if(same ? ls_in_segment(&lst,x,z,y)!=ls_in_segment(&arr,x,z,y)
+              : ls_in_segment(&lst,z,x,y)!=ls_in_segment(&arr,x,z,y)){
+        fprintf(stderr,"error: two-level list between(%d,%d,%d) is wrong.\n",x,y,z);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  ls_store(&lst);
+  for(v=0;v<n;v++) arr.active[v]=0;
+  for(k=0;k<n;k++){
+    if(arr.active[tour2[k]]++ || ls_succ(&lst,tour2[k])!=tour2[k+1==n ? 0 : k+1]){
+      fprintf(stderr,"error: two-level list does not give the tour.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  printf("two-level list check: %d moves on %d segments ok\n",moves,lst.tl.segs);
+  free(tour);
+  free(tour2);
+  free_local_search(&arr);
+  free_local_search(&lst);
+}
+
+/***** local search with neighbour lists and don't-look bits until the ******/
+/***** queue is empty or the deadline; returns the total gain ***************/
+/***** 2-opt is tried first, then Or-opt (LS_OROPT) and variable-depth ******/
+/***** moves (LS_LK) ********************************************************/
+long long improve_tour( LocalSearch *ls, TSPdata *tspdata, DistCache *dc, Neighbors *nb,
+                        int level ){
+  long long gain=0,g;
+  int count=0,a;
+
+  while(ls->qnum>0){
+    if((++count & 255)==0 && search_time()>=ls->deadline) break;
+    a=ls_pop(ls);
+    g=two_opt_node(ls,tspdata,dc,nb,a);
+    if(g==0 && level>=LS_OROPT)
+      g=or_opt_node(ls,tspdata,dc,nb,a);
+    if(g==0 && level>=LS_LK)
+      g=lk_node(ls,tspdata,dc,nb,a);
+    gain+=g;
+  }
+  return gain;
+}
+
+/***** improve a complete tour (nodes 0..n-1) in place by param->localsearch */
+/***** the nodes before position "from" are assumed to be locally optimal ***/
+long long local_search( Param *param, LocalSearch *ls, TSPdata *tspdata,
+                        DistCache *dc, Neighbors *nb, int *tour, int from ){
+  long long gain;
+  double t;
+
+  if(param->localsearch==LS_NONE || nb->k==0) return 0;
+  t=thread_time();
+  ls_load(ls,tour,from);
+  gain=improve_tour(ls,tspdata,dc,nb,param->localsearch);
+  ls_store(ls);
+  ls->time+=thread_time()-t;
+  return gain;
+}
+
+/***** edge assembly crossover (EAX) on routes ******************************/
+void alloc_eax( Eax *E, int n ){
+  int v;
+
+  E->n=n;
+  E->alink=(int*)malloc_e(2*n*sizeof(int));
+  E->link=(int*)malloc_e(2*n*sizeof(int));
+  E->ra=(int*)malloc_e(2*n*sizeof(int));
+  E->rb=(int*)malloc_e(2*n*sizeof(int));
+  E->path=(int*)malloc_e((2*n+1)*sizeof(int));
+  E->at=(int*)malloc_e(2*n*sizeof(int));
+  E->cyc=(int*)malloc_e(2*n*sizeof(int));
+  E->cstart=(int*)malloc_e((n+1)*sizeof(int));
+  E->order=(int*)malloc_e(n*sizeof(int));
+  E->comp=(int*)malloc_e(n*sizeof(int));
+  E->cnext=(int*)malloc_e(n*sizeof(int));
+  E->chead=(int*)malloc_e(n*sizeof(int));
+  E->ctail=(int*)malloc_e(n*sizeof(int));
+  E->csize=(int*)malloc_e(n*sizeof(int));
+  E->touched=(int*)malloc_e(4*n*sizeof(int));
+  for(v=0;v<2*n;v++) E->at[v]=-1;
+  for(v=0;v<n;v++) E->comp[v]=-1;
+  E->label=0;
+  E->ncyc=0;
+  E->ntouched=0;
+  E->deadline=0;
+}
+
+void free_eax( Eax *E ){
+  free(E->alink);
+  free(E->link);
+  free(E->ra);
+  free(E->rb);
+  free(E->path);
+  free(E->at);
+  free(E->cyc);
+  free(E->cstart);
+  free(E->order);
+  free(E->comp);
+  free(E->cnext);
+  free(E->chead);
+  free(E->ctail);
+  free(E->csize);
+  free(E->touched);
+}
+
+/***** take the remaining edge {v,r[2v+s]} out of the adjacency r ***********/
+int eax_take( int *r, int v, int s ){
+  int w=r[2*v+s];
+
+  r[2*v+s]=-1;
+  if(r[2*w]==v) r[2*w]=-1;
+  else          r[2*w+1]=-1;
+  return w;
+}
+
+/***** split the edges of A and B that are not common into AB-cycles, *******/
+/***** alternating A- and B-edges, by random walks on the remaining edges ***/
+void eax_ab_cycles( Eax *E, int *A, int *B ){
+  int n=E->n,*ra=E->ra,*rb=E->rb,*r,*path=E->path,*at=E->at;
+  int k,v,w,s,p,j,m,t,len,cur,total=0;
+
+  for(k=0;k<n;k++){
+    v=A[k];
+    E->alink[2*v]=A[k==0 ? n-1 : k-1];
+    E->alink[2*v+1]=A[k+1==n ? 0 : k+1];
+    v=B[k];
+    rb[2*v]=B[k==0 ? n-1 : k-1];
+    rb[2*v+1]=B[k+1==n ? 0 : k+1];
+  }
+  for(v=0;v<2*n;v++) E->link[v]=E->alink[v];
+  for(v=0;v<n;v++){
+    for(s=0;s<2;s++){
+      w=E->alink[2*v+s];
+      ra[2*v+s]=(w==rb[2*v] || w==rb[2*v+1]) ? -1 : w;
+    }
+    for(s=0;s<2;s++){
+      w=rb[2*v+s];
+      if(w==E->alink[2*v] || w==E->alink[2*v+1]) rb[2*v+s]=-1;
+    }
+  }
+
+  E->ncyc=0;
+  E->cstart[0]=0;
+  for(v=0;v<n;v++){
+    while(ra[2*v]>=0 || ra[2*v+1]>=0){
+      path[0]=cur=v;
+      at[2*v]=0;
+      len=1;
+      for(;;){
+        /* the edge leaving path[len-1] is an A-edge at even positions */
+        r=((len-1)%2==0) ? ra : rb;
+        if(r[2*cur]>=0) s=(r[2*cur+1]>=0) ? rng_below(2) : 0;
+        else if(r[2*cur+1]>=0) s=1;
+        else{
+          /* no way to go on; the edges of the path are given up */
+          for(k=0;k<len;k++) at[2*path[k]+k%2]=-1;
+          break;
+        }
+        w=eax_take(r,cur,s);
+        path[len++]=w;
+        p=(len-1)%2;
+        if(at[2*w+p]<0){
+          at[2*w+p]=len-1;
+          cur=w;
+          continue;
+        }
+        /* path[j..len-1] closes an AB-cycle; store it from an A-edge on */
+        j=at[2*w+p];
+        m=len-1-j;
+        for(t=0;t<m;t++)
+          E->cyc[total+t]=path[j+(t+j%2)%m];
+        total+=m;
+        E->cstart[++E->ncyc]=total;
+        for(k=j+1;k<len-1;k++) at[2*path[k]+k%2]=-1;
+        len=j+1;
+        cur=w;
+        if(len==1){
+          at[2*v]=-1;
+          break;
+        }
+      }
+    }
+  }
+}
+
+void eax_remove_edge( int *link, int u, int v ){
+  if(link[2*u]==v) link[2*u]=-1; else link[2*u+1]=-1;
+  if(link[2*v]==u) link[2*v]=-1; else link[2*v+1]=-1;
+}
+
+void eax_add_edge( int *link, int u, int v ){
+  if(link[2*u]<0) link[2*u]=v; else link[2*u+1]=v;
+  if(link[2*v]<0) link[2*v]=u; else link[2*v+1]=u;
+}
+
+/***** the neighbour of v in link other than u ******************************/
+int eax_other( int *link, int v, int u ){
+  return link[2*v]==u ? link[2*v+1] : link[2*v];
+}
+
+/***** replace the A-edges of AB-cycle c by its B-edges in E->link and ******/
+/***** merge the subtours, the smallest first, by the cheapest exchange *****/
+/***** of two edges found through the neighbour lists; returns the change ***/
+/***** of the cost (restore E->link with eax_restore()) *********************/
+long long eax_apply( Eax *E, int c, TSPdata *tspdata, DistCache *dc, Neighbors *nb ){
+  int *cy=E->cyc+E->cstart[c],m=E->cstart[c+1]-E->cstart[c];
+  int *link=E->link,*comp=E->comp;
+  int t,k,v,w,x,base,nc,live,U,W,u,u1,v1,su,sv,bu,bu1,bv,bv1,bcross;
+  long long delta=0,g,best;
+
+  for(t=0;t<m;t+=2){
+    eax_remove_edge(link,cy[t],cy[t+1]);
+    delta-=cached_dist(dc,tspdata,cy[t],cy[t+1]);
+  }
+  for(t=1;t<m;t+=2){
+    w=cy[t+1==m ? 0 : t+1];
+    eax_add_edge(link,cy[t],w);
+    delta+=cached_dist(dc,tspdata,cy[t],w);
+  }
+  for(t=0;t<m;t++) E->touched[t]=cy[t];
+  E->ntouched=m;
+
+  /* every subtour contains a node of the AB-cycle */
+  if(E->label>(1<<30)){
+    for(v=0;v<E->n;v++) comp[v]=-1;
+    E->label=0;
+  }
+  base=E->label;
+  nc=0;
+  for(t=0;t<m;t++){
+    if(comp[cy[t]]>=base) continue;
+    E->chead[nc]=cy[t];
+    E->csize[nc]=0;
+    v=cy[t];
+    w=link[2*v+1];
+    do{
+      comp[v]=base+nc;
+      E->csize[nc]++;
+      E->ctail[nc]=v;
+      x=eax_other(link,v,w);
+      E->cnext[v]=(x==cy[t]) ? -1 : x;
+      w=v;
+      v=x;
+    }while(v!=cy[t]);
+    nc++;
+  }
+  E->label=base+nc;
+
+  for(live=nc;live>1;live--){
+    U=-1;
+    for(k=0;k<nc;k++)
+      if(E->csize[k]>0 && (U<0 || E->csize[k]<E->csize[U])) U=k;
+    best=LLONG_MAX;
+    bu=bu1=bv=bv1=bcross=-1;
+    for(u=E->chead[U];u>=0;u=E->cnext[u]){
+      for(k=nb->start[u];k<nb->start[u+1];k++){
+        v=nb->adj[k];
+        if(comp[v]==base+U) continue;
+        for(su=0;su<2;su++){
+          u1=link[2*u+su];
+          for(sv=0;sv<2;sv++){
+            v1=link[2*v+sv];
+            g=(long long)nb->len[k]+cached_dist(dc,tspdata,u1,v1)
+              -cached_dist(dc,tspdata,u,u1)-cached_dist(dc,tspdata,v,v1);
+            if(g<best){ best=g; bu=u; bu1=u1; bv=v; bv1=v1; bcross=0; }
+            g=(long long)cached_dist(dc,tspdata,u,v1)+cached_dist(dc,tspdata,u1,v)
+              -cached_dist(dc,tspdata,u,u1)-cached_dist(dc,tspdata,v,v1);
+            if(g<best){ best=g; bu=u; bu1=u1; bv=v; bv1=v1; bcross=1; }
+          }
+        }
+      }
+    }
+    if(bu<0){
+      /* no neighbour outside the subtour: any node will do */
+      u=E->chead[U];
+      for(v=0;v<E->n;v++){
+        if(comp[v]==base+U) continue;
+        for(su=0;su<2;su++){
+          u1=link[2*u+su];
+          for(sv=0;sv<2;sv++){
+            v1=link[2*v+sv];
+            g=(long long)cached_dist(dc,tspdata,u,v)+cached_dist(dc,tspdata,u1,v1)
+              -cached_dist(dc,tspdata,u,u1)-cached_dist(dc,tspdata,v,v1);
+            if(g<best){ best=g; bu=u; bu1=u1; bv=v; bv1=v1; bcross=0; }
+          }
+        }
+      }
+    }
+    eax_remove_edge(link,bu,bu1);
+    eax_remove_edge(link,bv,bv1);
+    if(bcross){
+      eax_add_edge(link,bu,bv1);
+      eax_add_edge(link,bu1,bv);
+    }
+    else{
+      eax_add_edge(link,bu,bv);
+      eax_add_edge(link,bu1,bv1);
+    }
+    delta+=best;
+    E->touched[E->ntouched++]=bu;
+    E->touched[E->ntouched++]=bu1;
+    E->touched[E->ntouched++]=bv;
+    E->touched[E->ntouched++]=bv1;
+    /* the nodes of U join the subtour W of bv */
+    W=comp[bv]-base;
+    for(u=E->chead[U];u>=0;u=E->cnext[u]) comp[u]=base+W;
+    E->cnext[E->ctail[W]]=E->chead[U];
+    E->ctail[W]=E->ctail[U];
+    E->csize[W]+=E->csize[U];
+    E->csize[U]=0;
+  }
+  return delta;
+}
+
+void eax_restore( Eax *E ){
+  int t,v;
+
+  for(t=0;t<E->ntouched;t++){
+    v=E->touched[t];
+    E->link[2*v]=E->alink[2*v];
+    E->link[2*v+1]=E->alink[2*v+1];
+  }
+  E->ntouched=0;
+}
+
+/***** child of A and B: A with the single AB-cycle (out of EAX_TRIALS *******/
+/***** random ones) that gives the shortest tour, or A itself if none is ****/
+/***** shorter; returns the cost of the child *******************************/
+long long eax_child( Eax *E, int *A, int *B, long long cost, int *child,
+                     TSPdata *tspdata, DistCache *dc, Neighbors *nb ){
+  int n=E->n,k,t,c,bc=-1,v,w,x;
+  long long d,best=0;
+
+  eax_ab_cycles(E,A,B);
+  for(c=0;c<E->ncyc;c++) E->order[c]=c;
+  for(t=0;t<E->ncyc && t<EAX_TRIALS;t++){
+    if(search_time()>=E->deadline) break;
+    k=t+rng_below(E->ncyc-t);
+    c=E->order[k];
+    E->order[k]=E->order[t];
+    E->order[t]=c;
+    d=eax_apply(E,c,tspdata,dc,nb);
+    eax_restore(E);
+    if(d<best){ best=d; bc=c; }
+  }
+  if(bc<0){
+    memcpy(child,A,n*sizeof(int));
+    return cost;
+  }
+  eax_apply(E,bc,tspdata,dc,nb);
+  v=A[0];
+  w=E->link[2*v];
+  for(k=0;k<n;k++){
+    child[k]=v;
+    x=eax_other(E->link,v,w);
+    w=v;
+    v=x;
+  }
+  eax_restore(E);
+  return cost+best;
+}
+
+/***** generalized partition crossover (GPX) on routes *********************/
+void alloc_gpx( Gpx *G, int n ){
+  G->n=n;
+  G->alink=(int*)malloc_e(2*n*sizeof(int));
+  G->blink=(int*)malloc_e(2*n*sizeof(int));
+  G->comp=(int*)malloc_e(n*sizeof(int));
+  G->stack=(int*)malloc_e(n*sizeof(int));
+  G->partner=(int*)malloc_e(n*sizeof(int));
+  G->state=(int*)malloc_e(n*sizeof(int));
+  G->cost_a=(long long*)malloc_e(n*sizeof(long long));
+  G->cost_b=(long long*)malloc_e(n*sizeof(long long));
+}
+
+void free_gpx( Gpx *G ){
+  free(G->alink);
+  free(G->blink);
+  free(G->comp);
+  free(G->stack);
+  free(G->partner);
+  free(G->state);
+  free(G->cost_a);
+  free(G->cost_b);
+}
+
+/***** is {v,w} an edge of the adjacency link *******************************/
+int gpx_has_edge( int *link, int v, int w ){
+  return link[2*v]==w || link[2*v+1]==w;
+}
+
+/***** the runs of tour[] within one component: partner[] pairs the ends ****/
+/***** of each run (check=0), or the component is marked GPX_FROM_A if the **/
+/***** runs do not pair the ends in the same way (check=1) *****************/
+void gpx_runs( Gpx *G, int *tour, int check ){
+  int n=G->n,*comp=G->comp,k,s,first,v,w;
+
+  /* start at a node that begins a run */
+  for(s=0;s<n && comp[tour[s]]==comp[tour[s==0 ? n-1 : s-1]];s++);
+  if(s==n) return;
+  first=tour[s];
+  for(k=0;k<n;k++){
+    v=tour[(s+k)%n];
+    w=tour[(s+k+1)%n];
+    if(comp[w]==comp[v]) continue;
+    if(!check){
+      G->partner[first]=v;
+      G->partner[v]=first;
+    }
+    else if(G->partner[first]!=v)
+      G->state[comp[v]]=GPX_FROM_A;
+    first=w;
+  }
+}
+
+/***** child of A and B: the union graph without the common edges is ********/
+/***** split into connected components in O(n); a component whose paths ****/
+/***** join the same pairs of nodes in both parents can take the B-edges ***/
+/***** without breaking the tour and takes the shorter ones, any other *****/
+/***** one comes from A; returns the cost of the child, not longer than A **/
+long long gpx_child( Gpx *G, int *A, int *B, long long cost, int *child,
+                     TSPdata *tspdata, DistCache *dc ){
+  int n=G->n,*alink=G->alink,*blink=G->blink,*comp=G->comp;
+  int k,v,w,x,s,nc,top,*link;
+  long long gain=0;
+
+  for(k=0;k<n;k++){
+    v=A[k];
+    alink[2*v]=A[k==0 ? n-1 : k-1];
+    alink[2*v+1]=A[k+1==n ? 0 : k+1];
+    v=B[k];
+    blink[2*v]=B[k==0 ? n-1 : k-1];
+    blink[2*v+1]=B[k+1==n ? 0 : k+1];
+  }
+  for(v=0;v<n;v++) comp[v]=-1;
+
+  /* components of the edges that are not common */
+  nc=0;
+  for(v=0;v<n;v++){
+    if(comp[v]>=0) continue;
+    comp[v]=nc;
+    G->state[nc]=GPX_FEASIBLE;
+    G->cost_a[nc]=0;
+    G->cost_b[nc]=0;
+    G->stack[0]=v;
+    top=1;
+    while(top>0){
+      x=G->stack[--top];
+      for(s=0;s<4;s++){
+        link=(s<2) ? alink : blink;
+        w=link[2*x+s%2];
+        if(gpx_has_edge(s<2 ? blink : alink,x,w)) continue;
+        /* each edge is counted from its smaller end */
+        if(x<w){
+          if(s<2) G->cost_a[nc]+=cached_dist(dc,tspdata,x,w);
+          else    G->cost_b[nc]+=cached_dist(dc,tspdata,x,w);
+        }
+        if(comp[w]<0){
+          comp[w]=nc;
+          G->stack[top++]=w;
+        }
+      }
+    }
+    nc++;
+  }
+  if(nc==1) G->state[0]=GPX_FROM_A;
+  gpx_runs(G,A,0);
+  gpx_runs(G,B,1);
+
+  /* the feasible components that are shorter in B take the B-edges */
+  for(k=0;k<nc;k++){
+    if(G->state[k]==GPX_FEASIBLE && G->cost_b[k]<G->cost_a[k]){
+      gain+=G->cost_a[k]-G->cost_b[k];
+      G->state[k]=GPX_FROM_B;
+    }
+  }
+  if(gain==0){
+    memcpy(child,A,n*sizeof(int));
+    return cost;
+  }
+
+  /* walk the child; a node of a component taken from B uses its B-edges */
+  v=A[0];
+  w=alink[2*v];
+  for(k=0;k<n;k++){
+    child[k]=v;
+    link=(G->state[comp[v]]==GPX_FROM_B) ? blink : alink;
+    x=(link[2*v]==w) ? link[2*v+1] : link[2*v];
+    w=v;
+    v=x;
+  }
+  return cost-gain;
+}
+
+/***** scratch of the route crossovers; EAX and GPX only if they are used **/
+void alloc_recomb( Recomb *R, int n, int crossover ){
+  int v;
+
+  R->n=n;
+  if(crossover==CX_EAX || crossover==CX_MIXED) alloc_eax(&R->eax,n);
+  if(crossover==CX_GPX || crossover==CX_MIXED) alloc_gpx(&R->gpx,n);
+  R->pos=(int*)malloc_e(n*sizeof(int));
+  R->mark=(int*)malloc_e(n*sizeof(int));
+  R->adj=(int*)malloc_e(4*n*sizeof(int));
+  R->deg=(int*)malloc_e(n*sizeof(int));
+  R->rest=(int*)malloc_e(n*sizeof(int));
+  R->at=(int*)malloc_e(n*sizeof(int));
+  for(v=0;v<n;v++) R->mark[v]=0;
+  R->stamp=0;
+}
+
+void free_recomb( Recomb *R, int crossover ){
+  if(crossover==CX_EAX || crossover==CX_MIXED) free_eax(&R->eax);
+  if(crossover==CX_GPX || crossover==CX_MIXED) free_gpx(&R->gpx);
+  free(R->pos);
+  free(R->mark);
+  free(R->adj);
+  free(R->deg);
+  free(R->rest);
+  free(R->at);
+}
+
+/***** a new value of the marks, so that no node is marked ******************/
+void recomb_unmark( Recomb *R ){
+  int v;
+
+  if(++R->stamp==INT_MAX){
+    for(v=0;v<R->n;v++) R->mark[v]=0;
+    R->stamp=1;
+  }
+}
+
+/***** random cut positions 0 <= *i <= *j < n *******************************/
+void recomb_cuts( int n, int *i, int *j ){
+  int t;
+
+  *i=rng_below(n);
+  *j=rng_below(n);
+  if(*i>*j){ t=*i; *i=*j; *j=t; }
+}
+
+long long eax_operator( Recomb *R, int *A, int *B, long long cost, int *child,
+                        TSPdata *tspdata, Vdata *vdata ){
+  return eax_child(&R->eax,A,B,cost,child,tspdata,&vdata->dcache,&vdata->nb);
+}
+
+long long gpx_operator( Recomb *R, int *A, int *B, long long cost, int *child,
+                        TSPdata *tspdata, Vdata *vdata ){
+  return gpx_child(&R->gpx,A,B,cost,child,tspdata,&vdata->dcache);
+}
+
+/***** order crossover (OX): A[i..j] stays in place, the other positions ****/
+/***** from j+1 on get the remaining nodes in the order of B from j+1 on ****/
+long long ox_operator( Recomb *R, int *A, int *B, long long cost, int *child,
+                       TSPdata *tspdata, Vdata *vdata ){
+  int n=R->n,i,j,k,l,v;
+
+  (void)cost;   /* the child is evaluated from scratch */
+  recomb_cuts(n,&i,&j);
+  recomb_unmark(R);
+  for(k=i;k<=j;k++){
+    child[k]=A[k];
+    R->mark[A[k]]=R->stamp;
+  }
+  l=(j+1)%n;
+  for(k=0;k<n;k++){
+    v=B[(j+1+k)%n];
+    if(R->mark[v]==R->stamp) continue;
+    child[l]=v;
+    l=(l+1)%n;
+  }
+  return route_cost(&vdata->dcache,tspdata,child);
+}
+
+/***** partially mapped crossover (PMX): A[i..j] stays in place, the other **/
+/***** positions keep the node of B, mapped through A[i..j] <-> B[i..j] ****/
+/***** while it is already in the child ************************************/
+long long pmx_operator( Recomb *R, int *A, int *B, long long cost, int *child,
+                        TSPdata *tspdata, Vdata *vdata ){
+  int n=R->n,i,j,k,v;
+
+  (void)cost;   /* the child is evaluated from scratch */
+  recomb_cuts(n,&i,&j);
+  recomb_unmark(R);
+  for(k=i;k<=j;k++){
+    child[k]=A[k];
+    R->mark[A[k]]=R->stamp;
+    R->pos[A[k]]=k;
+  }
+  for(k=0;k<n;k++){
+    if(k==i){ k=j; continue; }
+    v=B[k];
+    while(R->mark[v]==R->stamp) v=B[R->pos[v]];
+    child[k]=v;
+  }
+  return route_cost(&vdata->dcache,tspdata,child);
+}
+
+/***** edge recombination (ERX): from A[0] on, go to the neighbour in A or **/
+/***** B with the fewest unused edges left, a random unused node if there **/
+/***** is none; edges common to A and B are preferred ***********************/
+long long erx_operator( Recomb *R, int *A, int *B, long long cost, int *child,
+                        TSPdata *tspdata, Vdata *vdata ){
+  int n=R->n,*adj=R->adj,*deg=R->deg,k,l,m,v,w,x,best,num;
+  int *tour[2];
+
+  (void)cost;   /* the child is evaluated from scratch */
+  tour[0]=A;
+  tour[1]=B;
+  for(v=0;v<n;v++) deg[v]=0;
+  for(m=0;m<2;m++){
+    for(k=0;k<n;k++){
+      v=tour[m][k];
+      for(l=0;l<2;l++){
+        w=tour[m][l ? (k+1)%n : (k+n-1)%n];
+        for(x=0;x<deg[v] && adj[4*v+x]!=w;x++);
+        if(x<deg[v]) adj[4*v+x]=-1-w;   /* common edge */
+        else         adj[4*v+deg[v]++]=w;
+      }
+    }
+  }
+  for(k=0;k<n;k++){
+    R->rest[k]=k;
+    R->at[k]=k;
+  }
+  num=n;
+  v=A[0];
+  for(k=0;k<n;k++){
+    child[k]=v;
+    /* v leaves the rest and the lists of its neighbours */
+    x=R->rest[--num];
+    R->rest[R->at[v]]=x;
+    R->at[x]=R->at[v];
+    for(l=0;l<deg[v];l++){
+      w=adj[4*v+l];
+      if(w<0) w=-1-w;
+      for(x=0;x<deg[w] && adj[4*w+x]!=v && adj[4*w+x]!=-1-v;x++);
+      adj[4*w+x]=adj[4*w+deg[w]-1];
+      deg[w]--;
+    }
+    if(num==0) break;
+    best=-1;
+    for(l=0;l<deg[v];l++){
+      w=adj[4*v+l];
+      if(w<0){ best=-1-w; break; }
+      if(best<0 || deg[w]<deg[best] || (deg[w]==deg[best] && rng_below(2))) best=w;
+    }
+    v=(best>=0) ? best : R->rest[rng_below(num)];
+  }
+  return route_cost(&vdata->dcache,tspdata,child);
+}
+
+/***** cycle crossover (CX): the position cycles of A and B are taken from **/
+/***** A and B in turn ******************************************************/
+long long cx_operator( Recomb *R, int *A, int *B, long long cost, int *child,
+                       TSPdata *tspdata, Vdata *vdata ){
+  int n=R->n,k,l,c=0;
+
+  (void)cost;   /* the child is evaluated from scratch */
+  recomb_unmark(R);
+  for(k=0;k<n;k++) R->pos[A[k]]=k;
+  for(k=0;k<n;k++){
+    if(R->mark[A[k]]==R->stamp) continue;
+    for(l=k;R->mark[A[l]]!=R->stamp;l=R->pos[B[l]]){
+      R->mark[A[l]]=R->stamp;
+      child[l]=(c%2==0) ? A[l] : B[l];
+    }
+    c++;
+  }
+  return route_cost(&vdata->dcache,tspdata,child);
+}
+
+/***** the crossover table; entry CX_TWOPOINT works on the genes instead ****/
+void init_operators( Operator *op ){
+  int k;
+
+  op[CX_TWOPOINT].name="two-point"; op[CX_TWOPOINT].child=NULL;         op[CX_TWOPOINT].polish=0;
+  op[CX_EAX].name="EAX";            op[CX_EAX].child=eax_operator;      op[CX_EAX].polish=0;
+  op[CX_GPX].name="GPX";            op[CX_GPX].child=gpx_operator;      op[CX_GPX].polish=1;
+  op[CX_OX].name="OX";              op[CX_OX].child=ox_operator;        op[CX_OX].polish=1;
+  op[CX_PMX].name="PMX";            op[CX_PMX].child=pmx_operator;      op[CX_PMX].polish=1;
+  op[CX_ERX].name="ERX";            op[CX_ERX].child=erx_operator;      op[CX_ERX].polish=1;
+  op[CX_CX].name="CX";              op[CX_CX].child=cx_operator;        op[CX_CX].polish=1;
+  for(k=0;k<CX_NUM;k++){
+    op[k].children=0;
+    op[k].improved=0;
+    op[k].time=0;
+  }
+}
+
+void print_array(int *a, int n){
+    int i, s[n];
+
+    
+    for (i = 0; i < n; i++)
+    {
+        s[i] = a[i];
+        printf("%d ", s[i]);
+    }
+    printf("\n");
+}
+
+void print_matrix(int pop, int n, int a[][n]){
+    int i, j;
+    
+    for (i = 0; i < pop; i++)
+    {
+        for (j = 0; j < n; j++)
+        {
+            printf("%d ", a[i][j]);
+        }
+        printf("\n");
+    }
+}
+
+void create_matrix(int pop, int n, int a[][n])
+{
+    int i, j;
+
+    for (i = 0; i < pop; i++)
+    {
+        /* the bits of a row are drawn in bulk, then bounded one by one */
+        rng_fill((unsigned int*)a[i], n);
+        for (j = 0; j < n; j++)
+        {
+            a[i][j] = rng_bounded((unsigned int)a[i][j], n - j) + 1;
+        }
+    }
+}
+
+void copy_array(int *a, int n, int j)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (i == j - 1)
+        {
+            a[i] = a[i + 1];
+            for (i = j; i < n - 1; i++)
+            {
+                a[i] = a[i + 1];
+            }
+            a[n - 1] = 0;
+        }
+    }  
+}
+
+/***** Fenwick tree over the remaining order list ***************************/
+/***** tree[1..n] counts the nodes that are not yet taken by the route *******/
+void fenwick_fill(int *tree, int n)
+{
+  int i;
+
+  for (i = 1; i <= n; i++)
+  {
+    tree[i] = i & (-i);
+  }
+}
+
+/***** the remaining order list after the first "from" nodes of a route *****/
+void fenwick_build(int *tree, int n, int *route, int from)
+{
+  int i, p;
+
+  for (i = 1; i <= n; i++)
+  {
+    tree[i] = 1;
+  }
+  for (i = 0; i < from; i++)
+  {
+    tree[route[i] + 1] = 0;
+  }
+  for (i = 1; i <= n; i++)
+  {
+    p = i + (i & (-i));
+    if (p <= n)
+    {
+      tree[p] += tree[i];
+    }
+  }
+}
+
+/***** remove node v (1..n) from the remaining order list ******************/
+void fenwick_remove(int *tree, int n, int v)
+{
+  int i;
+
+  for (i = v; i <= n; i += i & (-i))
+  {
+    tree[i]--;
+  }
+}
+
+/***** number of remaining nodes whose number is at most v ******************/
+int fenwick_rank(int *tree, int v)
+{
+  int i, r = 0;
+
+  for (i = v; i > 0; i -= i & (-i))
+  {
+    r += tree[i];
+  }
+
+  return r;
+}
+
+/***** take the k-th remaining node (1-based) and return its number 1..n *****/
+int fenwick_take(int *tree, int n, int k)
+{
+  int pos = 0, step = 1;
+
+  while ((step << 1) <= n)
+  {
+    step <<= 1;
+  }
+  for (; step > 0; step >>= 1)
+  {
+    if (pos + step <= n && tree[pos + step] < k)
+    {
+      pos += step;
+      k -= tree[pos];
+    }
+  }
+  pos++;
+  fenwick_remove(tree, n, pos);
+
+  return pos;
+}
+
+/***** ordinal g at a position where "left" nodes remain, clamped to ******/
+/***** 1..left so that a gene out of range still decodes into a route *******/
+static inline int gene_rank(int g, int left)
+{
+  return g < 1 ? 1 : (g > left ? left : g);
+}
+
+/***** decode one ordinal gene into a route (nodes 0..n-1) in O(n log n) ****/
+void decode_gene(int n, int *gene, int *route, int *tree)
+{
+  int j;
+
+  fenwick_fill(tree, n);
+  for (j = 0; j < n; j++)
+  {
+    route[j] = fenwick_take(tree, n, gene_rank(gene[j], n - j)) - 1;
+  }
+}
+
+/***** decode the gene from position "from" on, route[0..from-1] is kept ****/
+void decode_gene_from(int n, int *gene, int *route, int *tree, int from)
+{
+  int j;
+
+  fenwick_build(tree, n, route, from);
+  for (j = from; j < n; j++)
+  {
+    route[j] = fenwick_take(tree, n, gene_rank(gene[j], n - j)) - 1;
+  }
+}
+
+/***** encode a route (nodes 0..n-1) into an ordinal gene in O(n log n) ***/
+/***** this is the inverse of decode_gene() *********************************/
+void encode_gene(int n, int *route, int *gene, int *tree)
+{
+  int j;
+
+  fenwick_fill(tree, n);
+  for (j = 0; j < n; j++)
+  {
+    gene[j] = fenwick_rank(tree, route[j] + 1);
+    fenwick_remove(tree, n, route[j] + 1);
+  }
+}
+
+/***** reference decoder shifting the order list, O(n^2) ********************/
+void decode_gene_naive(int n, int *gene, int *route, int *order_list)
+{
+  int j, k;
+
+  for (j = 0; j < n; j++)
+  {
+    order_list[j] = j;
+  }
+
+  for (j = 0; j < n; j++)
+  {
+    k = gene_rank(gene[j], n - j);
+    route[j] = order_list[k - 1];
+    copy_array(order_list, n, k);
+  }
+}
+
+/***** decode the population, dirty[i] is the first gene that has changed ***/
+/***** since route[i] was decoded (n: route[i] is up to date) ****************/
+/***** the individuals are decoded in parallel, each thread with its own ***/
+/***** block of tree (the blocks are tree_stride(n) entries apart) *********/
+void order_representation(int pop, int n, int a[][n], int route[][n], int *dirty, int *tree)
+{
+  int i;
+
+#pragma omp parallel for schedule(dynamic) if (n >= PARALLEL_MIN)
+  for (i = 0; i < pop; i++)
+  {
+    int *t = tree + (size_t)thread_num() * tree_stride(n);
+
+    if (dirty[i] == 0)
+    {
+      decode_gene(n, a[i], route[i], t);
+    }
+    else if (dirty[i] < n)
+    {
+      decode_gene_from(n, a[i], route[i], t, dirty[i]);
+    }
+  }
+}
+
+/***** decode every gene of n = 2 and 3 nodes whose ordinals are 0..n+1, ****/
+/***** the ones out of range included, with both decoders; the route must ***/
+/***** be a permutation and the genes in range must encode back *************/
+void check_small_decoder( void )
+{
+  int n, i, j, c, valid, total, gene[3], fast[3], naive[3], back[3], seen[3], tree[4];
+
+  for (n = 2; n <= 3; n++)
+  {
+    total = 1;
+    for (j = 0; j < n; j++)
+    {
+      total *= n + 2;
+    }
+    for (c = 0; c < total; c++)
+    {
+      valid = 1;
+      for (j = 0, i = c; j < n; j++, i /= n + 2)
+      {
+        gene[j] = i % (n + 2);
+        valid &= gene[j] >= 1 && gene[j] <= n - j;
+        seen[j] = 0;
+      }
+      decode_gene(n, gene, fast, tree);
+      decode_gene_naive(n, gene, naive, back);
+      encode_gene(n, fast, back, tree);
+      for (j = 0; j < n; j++)
+      {
+        if (fast[j] != naive[j] || fast[j] < 0 || fast[j] >= n || seen[fast[j]]++
+            || (valid && back[j] != gene[j]))
+        {
+          fprintf(stderr, "error: decoder mismatch on %d nodes, gene %d.\n", n, c);
+          exit(EXIT_FAILURE);
+        }
+      }
+    }
+  }
+}
+
+/***** compare the fast decoder with the reference one on the population *****/
+/***** and check that encoding the decoded routes gives back the genes *******/
+void check_decoder(int pop, int n, int a[][n])
+{
+  int i, j;
+  int *tree, *order_list, *fast, *naive, *gene;
+
+  tree       = (int*)malloc_e((n + 1)*sizeof(int));
+  order_list = (int*)malloc_e(n*sizeof(int));
+  fast       = (int*)malloc_e(n*sizeof(int));
+  naive      = (int*)malloc_e(n*sizeof(int));
+  gene       = (int*)malloc_e(n*sizeof(int));
+
+  for (i = 0; i < pop; i++)
+  {
+    decode_gene(n, a[i], fast, tree);
+    decode_gene_naive(n, a[i], naive, order_list);
+    encode_gene(n, fast, gene, tree);
+    for (j = 0; j < n; j++)
+    {
+      if (fast[j] != naive[j])
+      {
+        fprintf(stderr, "error: decoder mismatch at gene %d, position %d.\n", i, j);
+        exit(EXIT_FAILURE);
+      }
+      if (gene[j] != a[i][j])
+      {
+        fprintf(stderr, "error: encoder mismatch at gene %d, position %d.\n", i, j);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  check_small_decoder();
+  printf("decoder check: %d genes of %d nodes and all genes of 2 and 3 nodes ok\n", pop, n);
+
+  free(tree);
+  free(order_list);
+  free(fast);
+  free(naive);
+  free(gene);
+}
+
+/***** put a tour (nodes 0..n-1) into the gene pool as an ordinal gene *******/
+/***** returns 0 and leaves the gene as it is if the tour is not complete ****/
+int inject_tour(int n, int *tour, int *gene)
+{
+  int j, ok = 1;
+  int *tree;
+
+  tree = (int*)malloc_e((n + 1)*sizeof(int));
+
+  for (j = 0; j <= n; j++)
+  {
+    tree[j] = 0;
+  }
+  for (j = 0; j < n; j++)
+  {
+    if (tour[j] < 0 || tour[j] >= n || tree[tour[j] + 1])
+    {
+      ok = 0;
+      break;
+    }
+    tree[tour[j] + 1] = 1;
+  }
+  if (ok)
+  {
+    encode_gene(n, tour, gene, tree);
+  }
+
+  free(tree);
+
+  return ok;
+}
+
+
+/***** cost of a route whose positions from "from" on have changed; h ******/
+/***** holds h[0], the number of valid prefix costs, and h[b], the cost of **/
+/***** the edges in route[0..b*EVAL_BLOCK]. the costs before "from" are *****/
+/***** reused, the later ones are computed again (delta evaluation) *********/
+long long prefix_cost(DistCache *dc, TSPdata *tspdata, int *route, int n, long long *h, int from)
+{
+  int b, last = (n - 1) / EVAL_BLOCK;
+  long long cost;
+
+  b = from > 0 ? (from - 1) / EVAL_BLOCK : 0;
+  if (b > h[0])
+  {
+    b = (int)h[0];
+  }
+  cost = b > 0 ? h[b] : 0;
+  for (; b < last; b++)
+  {
+    cost += path_cost(dc, tspdata, route + (size_t)b * EVAL_BLOCK, EVAL_BLOCK + 1);
+    h[b + 1] = cost;
+  }
+  h[0] = last;
+  cost += path_cost(dc, tspdata, route + (size_t)last * EVAL_BLOCK, n - last * EVAL_BLOCK);
+  return cost + cached_dist(dc, tspdata, route[n - 1], route[0]);
+}
+
+/***** evaluate the routes, a[i] is the cost and head the prefix costs; *****/
+/***** a route changed from dirty[i] on is summed again from there only *****/
+void evaluate_route(int pop, int n, int route[][n], long long *a, long long *head, int *dirty,
+                    TSPdata *tspdata, DistCache *dc, int debug)
+{
+  int i;
+  size_t stride = prefix_stride(n);
+
+  /* the individuals are independent, so the order of the loop does not
+     change the results */
+#pragma omp parallel for schedule(dynamic) if (n >= PARALLEL_MIN)
+  for (i = 0; i < pop; i++)
+  {
+    if (dirty[i] == n)
+    {
+      continue;
+    }
+    a[i] = prefix_cost(dc, tspdata, route[i], n, head + i * stride, dirty[i]);
+    dirty[i] = n;
+  }
+
+  if (debug > 1)
+  {
+    for (i = 0; i < pop; i++)
+    {
+      if (a[i] != compute_cost(tspdata, route[i]))
+      {
+        fprintf(stderr, "error: delta evaluation mismatch on route %d.\n", i);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+}
+
+/***** move the routes and costs along with the selected genes **************/
+/***** only the prefix that is still valid for the new gene is copied ********/
+void inherit_routes(int pop, int n, int route[][n], int route_new[][n], int *src,
+                    int *dirty, long long *a, long long *head, long long *head_new)
+{
+  int i;
+  long long a_new[pop];
+  size_t stride = prefix_stride(n);
+
+  for (i = 0; i < pop; i++)
+  {
+    memcpy(route_new[i], route[src[i]], dirty[i]*sizeof(int));
+    memcpy(head_new + i * stride, head + src[i] * stride, stride * sizeof(long long));
+    a_new[i] = a[src[i]];
+  }
+  memcpy(a, a_new, sizeof(a_new));
+}
+
+/***** order of Ranked entries: smaller cost first, then smaller index *****/
+int compare_ranked(const void *p, const void *q)
+{
+  const Ranked *a = (const Ranked*)p, *b = (const Ranked*)q;
+
+  if (a->cost != b->cost)
+  {
+    return (a->cost < b->cost) ? -1 : 1;
+  }
+  return a->idx - b->idx;
+}
+
+/***** sort the individuals by cost in O(P log P) ****************************/
+void sort_by_cost(int pop, long long *a, Ranked *rank)
+{
+  int i;
+
+  for (i = 0; i < pop; i++)
+  {
+    rank[i].cost = a[i];
+    rank[i].idx = i;
+  }
+  qsort(rank, pop, sizeof(Ranked), compare_ranked);
+}
+
+/***** shuffle the parents so that the pairs of the crossover are random ****/
+void shuffle_parents(int pop, int *src)
+{
+  int i, j, t;
+
+  for (i = pop - 1; i > 0; i--)
+  {
+    j = rng_below(i + 1);
+    t = src[i];
+    src[i] = src[j];
+    src[j] = t;
+  }
+}
+
+/***** rank the individuals, src[i] is the one with the i-th best cost *****/
+/***** the genes are not moved, crossover reads them through src ************/
+void ranking_selection(int pop, long long *a, int *src, Ranked *rank)
+{
+  int i;
+
+  sort_by_cost(pop, a, rank);
+  for (i = 0; i < pop; i++)
+  {
+    src[i] = rank[i].idx;
+  }
+}
+
+/***** each parent is the best of "size" individuals drawn at random ********/
+void tournament_selection(int pop, long long *a, int *src, int size)
+{
+  int i, k, c, best;
+
+  for (i = 0; i < pop; i++)
+  {
+    best = rng_below(pop);
+    for (k = 1; k < size; k++)
+    {
+      c = rng_below(pop);
+      if (a[c] < a[best])
+      {
+        best = c;
+      }
+    }
+    src[i] = best;
+  }
+}
+
+/***** the best "percent" % of the individuals are the parents in turn *******/
+void truncation_selection(int pop, long long *a, int *src, Ranked *rank, int percent)
+{
+  int i, keep;
+
+  keep = pop * percent / 100;
+  if (keep < 2)
+  {
+    keep = 2;
+  }
+  if (keep > pop)
+  {
+    keep = pop;
+  }
+  sort_by_cost(pop, a, rank);
+  for (i = 0; i < pop; i++)
+  {
+    src[i] = rank[i % keep].idx;
+  }
+  shuffle_parents(pop, src);
+}
+
+/***** the individual of rank r (0: best) has the weight pop-r **************/
+/***** total weight is pop(pop+1)/2 *******************************************/
+double rank_weight_below(int pop, int r)
+{
+  /* the sum of the weights of the ranks 0..r-1 */
+  return (double)r * pop - (double)r * (r - 1) / 2.0;
+}
+
+/***** the rank whose cumulative weight interval contains w ******************/
+int rank_of_weight(int pop, double w)
+{
+  int lo = 0, hi = pop - 1, mid;
+
+  while (lo < hi)
+  {
+    mid = (lo + hi + 1) / 2;
+    if (rank_weight_below(pop, mid) <= w)
+    {
+      lo = mid;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
+  }
+
+  return lo;
+}
+
+/***** linear ranking: pop independent draws proportional to the weights ****/
+void linear_rank_selection(int pop, long long *a, int *src, Ranked *rank)
+{
+  int i;
+  double total;
+
+  sort_by_cost(pop, a, rank);
+  total = rank_weight_below(pop, pop);
+  for (i = 0; i < pop; i++)
+  {
+    src[i] = rank[rank_of_weight(pop, rng_unit() * total)].idx;
+  }
+}
+
+/***** stochastic universal sampling with the linear ranking weights ********/
+/***** one random offset and pop equally spaced pointers *********************/
+void sus_selection(int pop, long long *a, int *src, Ranked *rank)
+{
+  int i, r = 0;
+  double total, step, w;
+
+  sort_by_cost(pop, a, rank);
+  total = rank_weight_below(pop, pop);
+  step = total / pop;
+  w = rng_unit() * step;
+  for (i = 0; i < pop; i++, w += step)
+  {
+    while (r < pop - 1 && rank_weight_below(pop, r + 1) <= w)
+    {
+      r++;
+    }
+    src[i] = rank[r].idx;
+  }
+  shuffle_parents(pop, src);
+}
+
+/***** choose the parents of the next generation by param->selection ********/
+void select_parents(Param *param, int pop, long long *a, int *src, Ranked *rank)
+{
+  switch (param->selection)
+  {
+    case SEL_TOURNAMENT:
+      tournament_selection(pop, a, src, param->tournament);
+      break;
+    case SEL_TRUNCATION:
+      truncation_selection(pop, a, src, rank, param->truncation);
+      break;
+    case SEL_LINEAR_RANK:
+      linear_rank_selection(pop, a, src, rank);
+      break;
+    case SEL_SUS:
+      sus_selection(pop, a, src, rank);
+      break;
+    default:
+      ranking_selection(pop, a, src, rank);
+      break;
+  }
+}
+
+
+/***** write the children of the pairs (b[src[i]], b[src[i+1]]) into a ******/
+void tow_point_crossover(int pop, int n, int a[][n], int b[][n], int *src, int *dirty)
+{
+  int i, j, point;
+  int *p, *q;
+    
+  if ((n % 2) == 0)
+  {
+    point = (n / 2) - 1;
+  }else
+  {
+    point = ((n + 1)/2) - 1;
+  }  
+    
+  for (i = 0; i < pop; i=i+2)
+  {
+    p = b[src[i]];
+    q = b[src[i + 1]];
+    dirty[i] = n;
+    dirty[i + 1] = n;
+
+    for (j = 0; j < (point/2) + 1; j++)
+    {
+      a[i][j] = p[j];
+      a[i + 1][j] = q[j];
+    }
+    
+    for (j = (point/2) + 1; j < (point + (point/2)) + 1; j++)
+    {
+      a[i][j] = q[j];
+      a[i + 1][j] = p[j];
+      if (p[j] != q[j] && dirty[i] == n)
+      {
+        dirty[i] = j;
+        dirty[i + 1] = j;
+      }
+    }
+
+    for (j = (point + (point/2)) + 1; j < n; j++)
+    {
+      a[i][j] = p[j];
+      a[i + 1][j] = q[j];
+    }
+  }
+    
+}
+
+
+void mutation(int pop, int n, int a[][n], int *dirty)
+{
+  int i, point, r = rng_below(pop - 1) + 1;
+
+  if ((n % 2) == 0)
+  {
+    point = (n / 2);
+  }else
+  {
+    point = ((n + 1)/2);
+  }  
+  
+  if (r > (pop/2))
+  {
+    for (i = 0; i < point; i++)
+  {
+    a[r][i] = 1;
+  }
+  /* position point takes the ordinals 1..n-point */
+  if (n - point >= 2)
+  {
+    a[r][point] = 2;
+  }
+  dirty[r] = 0;
+
+  }else
+  {
+    for (i = point; i < n-10; i++)
+    {
+      a[r][i] = 1;
+    }
+    if (point + 10 < n - 1)
+    {
+      a[r][point+10] = 2;
+    }
+    if (dirty[r] > point)
+    {
+      dirty[r] = point;
+    }
+  }
+  
+}
+
+
+/***** whether route holds every node 0..n-1 once; seen has n entries ******/
+int is_route(int n, int *route, int *seen)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+  {
+    seen[j] = 0;
+  }
+  for (j = 0; j < n; j++)
+  {
+    if (route[j] < 0 || route[j] >= n || seen[route[j]]++)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/***** a route crossover of the table: slot i gets the child of ************/
+/***** A = route[src[i]] and B = route[src[i^1]], its gene is encoded and ***/
+/***** its cost is known; the operator is drawn per child for CX_MIXED *****/
+void route_crossover(int pop, int n, int a[][n], int route_new[][n], int route[][n], int *src,
+                     int *dirty, int *polish, long long *fit, long long *head, int *tree, Param *param,
+                     Operator *op, Recomb *R, TSPdata *tspdata, Vdata *vdata)
+{
+  int i, k;
+  long long fit_new[pop];
+  double t;
+
+  for (i = 0; i < pop; i++)
+  {
+    k = param->crossover;
+    if (k == CX_MIXED)
+    {
+      k = 1 + rng_below(CX_NUM - 1);
+    }
+    t = thread_time();
+    fit_new[i] = op[k].child(R, route[src[i]], route[src[i ^ 1]], fit[src[i]], route_new[i],
+                             tspdata, vdata);
+    op[k].time += thread_time() - t;
+    op[k].children++;
+    if (fit_new[i] < fit[src[i]] && fit_new[i] < fit[src[i ^ 1]])
+    {
+      op[k].improved++;
+    }
+    polish[i] = (op[k].polish && fit_new[i] != fit[src[i]]);
+    if (param->debug >= 2 && !is_route(n, route_new[i], tree))
+    {
+      fprintf(stderr, "error: crossover %s gave an invalid route.\n", op[k].name);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (i = 0; i < pop; i++)
+  {
+    encode_gene(n, route_new[i], a[i], tree);
+    fit[i] = fit_new[i];
+    /* the prefix costs are summed when the route changes next time */
+    head[i * prefix_stride(n)] = 0;
+    /* route_new[i] is the child already, a polished one goes through the
+       local search as it is and is evaluated again there */
+    dirty[i] = n;
+  }
+}
+
+
+/***** index of the cell (x,y) along the Hilbert curve of the grid ********/
+long long hilbert_index(int x, int y)
+{
+  long long d = 0;
+  int s, rx, ry, t;
+
+  for (s = 1 << (HILBERT_ORDER - 1); s > 0; s >>= 1)
+  {
+    rx = (x & s) > 0;
+    ry = (y & s) > 0;
+    d += (long long)s * s * ((3 * rx) ^ ry);
+    if (ry == 0)
+    {
+      if (rx == 1)
+      {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      t = x;
+      x = y;
+      y = t;
+    }
+  }
+  return d;
+}
+
+
+/***** the nodes in the order of a Hilbert curve over the bounding box; ****/
+/***** a random variant mirrors, swaps and shifts the curve ****************/
+void hilbert_tour(int n, int *tour, Ranked *key, TSPdata *tspdata, int randomize)
+{
+  int i, x, y, t, swap = 0, fx = 0, fy = 0;
+  double minx, miny, maxx, maxy, span, ox = 0, oy = 0, cells;
+
+  minx = maxx = tspdata->x[0];
+  miny = maxy = tspdata->y[0];
+  for (i = 1; i < n; i++)
+  {
+    if (tspdata->x[i] < minx) minx = tspdata->x[i];
+    if (tspdata->x[i] > maxx) maxx = tspdata->x[i];
+    if (tspdata->y[i] < miny) miny = tspdata->y[i];
+    if (tspdata->y[i] > maxy) maxy = tspdata->y[i];
+  }
+  span = (maxx - minx > maxy - miny) ? maxx - minx : maxy - miny;
+  if (span <= 0)
+  {
+    span = 1;
+  }
+  if (randomize)
+  {
+    ox = rng_unit() * span / 4;
+    oy = rng_unit() * span / 4;
+    span *= 1.25;
+    swap = rng_below(2);
+    fx = rng_below(2);
+    fy = rng_below(2);
+  }
+  cells = (double)((1 << HILBERT_ORDER) - 1);
+
+  for (i = 0; i < n; i++)
+  {
+    x = (int)((tspdata->x[i] - minx + ox) / span * cells);
+    y = (int)((tspdata->y[i] - miny + oy) / span * cells);
+    if (fx) x = (int)cells - x;
+    if (fy) y = (int)cells - y;
+    if (swap)
+    {
+      t = x;
+      x = y;
+      y = t;
+    }
+    key[i].cost = hilbert_index(x, y);
+    key[i].idx = i;
+  }
+  qsort(key, n, sizeof(Ranked), compare_ranked);
+  for (i = 0; i < n; i++)
+  {
+    tour[i] = key[i].idx;
+  }
+}
+
+
+/***** renumber the nodes along a Hilbert curve so that the coordinates ***/
+/***** of nearby nodes are close in memory; bestsol is renumbered too ******/
+void renumber_nodes(Param *param, TSPdata *tspdata, Vdata *vdata)
+{
+  int k, n = tspdata->n, *rank;
+  double *tmp;
+  Ranked *key;
+
+  if (!param->renumber || n < 2)
+  {
+    free(vdata->order);
+    vdata->order = NULL;
+    return;
+  }
+  /* the order may come from the cache of the instance */
+  if (vdata->order == NULL)
+  {
+    vdata->order = (int*)malloc_e(n * sizeof(int));
+    key = (Ranked*)malloc_e(n * sizeof(Ranked));
+    hilbert_tour(n, vdata->order, key, tspdata, 0);
+    free(key);
+  }
+
+  tmp = (double*)malloc_e(n * sizeof(double));
+  for (k = 0; k < n; k++)
+  {
+    tmp[k] = tspdata->x[vdata->order[k]];
+  }
+  memcpy(tspdata->x, tmp, n * sizeof(double));
+  for (k = 0; k < n; k++)
+  {
+    tmp[k] = tspdata->y[vdata->order[k]];
+  }
+  memcpy(tspdata->y, tmp, n * sizeof(double));
+  free(tmp);
+
+  rank = (int*)malloc_e(n * sizeof(int));
+  for (k = 0; k < n; k++)
+  {
+    rank[vdata->order[k]] = k;
+  }
+  for (k = 0; k < n; k++)
+  {
+    if (vdata->bestsol[k] >= 0 && vdata->bestsol[k] < n)
+    {
+      vdata->bestsol[k] = rank[vdata->bestsol[k]];
+    }
+  }
+  free(rank);
+}
+
+
+/***** back to the input numbering before the tour is checked and output ***/
+void restore_numbering(TSPdata *tspdata, Vdata *vdata)
+{
+  int k, n = tspdata->n;
+  double *tmp;
+
+  if (vdata->order == NULL)
+  {
+    return;
+  }
+  tmp = (double*)malloc_e(n * sizeof(double));
+  for (k = 0; k < n; k++)
+  {
+    tmp[vdata->order[k]] = tspdata->x[k];
+  }
+  memcpy(tspdata->x, tmp, n * sizeof(double));
+  for (k = 0; k < n; k++)
+  {
+    tmp[vdata->order[k]] = tspdata->y[k];
+  }
+  memcpy(tspdata->y, tmp, n * sizeof(double));
+  free(tmp);
+
+  for (k = 0; k < n; k++)
+  {
+    if (vdata->bestsol[k] >= 0)
+    {
+      vdata->bestsol[k] = vdata->order[vdata->bestsol[k]];
+    }
+  }
+  free(vdata->order);
+  vdata->order = NULL;
+}
+
+
+/***** nearest neighbour tour from node "start" through the k-d tree *******/
+void nearest_neighbor_tour(int n, int *tour, int start, TSPdata *tspdata, KdTree *kd)
+{
+  int i;
+  KdSet S;
+
+  alloc_kdset(&S, kd, 1);
+  tour[0] = start;
+  kdset_update(&S, start, -1);
+  for (i = 1; i < n; i++)
+  {
+    tour[i] = kdset_nearest(&S, tspdata, tour[i - 1]);
+    kdset_update(&S, tour[i], -1);
+  }
+  free_kdset(&S);
+}
+
+
+/***** the next node of a path given the previous one (-1 at the end) *****/
+int fragment_next(int *link, int v, int prev)
+{
+  int x = link[2 * v];
+
+  if (x < 0 || x == prev)
+  {
+    x = link[2 * v + 1];
+  }
+  return (x == prev) ? -1 : x;
+}
+
+
+/***** greedy edge tour: the candidate edges of the neighbour lists are ****/
+/***** taken from the shortest on if both ends have degree < 2 and they ****/
+/***** do not close a cycle; the paths are then joined from the end of *****/
+/***** each one to the nearest free end through the k-d tree; a random *****/
+/***** variant adds noise of up to INIT_NOISE to the edge lengths **********/
+void greedy_tour(int n, int *tour, TSPdata *tspdata, Vdata *vdata, int randomize)
+{
+  Neighbors *nb = &vdata->nb;
+  int i, k, l, u, v, a, b, m = 0, prev, start;
+  int *eu, *ev, *link, *deg, *other;
+  Ranked *edge;
+  KdSet S;
+
+  eu = (int*)malloc_e(((size_t)n * nb->k + 1) * sizeof(int));
+  ev = (int*)malloc_e(((size_t)n * nb->k + 1) * sizeof(int));
+  edge = (Ranked*)malloc_e(((size_t)n * nb->k + 1) * sizeof(Ranked));
+  link = (int*)malloc_e(2 * n * sizeof(int));
+  deg = (int*)malloc_e(n * sizeof(int));
+  other = (int*)malloc_e(n * sizeof(int));
+
+  /* each candidate edge once */
+  for (u = 0; u < n; u++)
+  {
+    for (k = nb->start[u]; k < nb->start[u + 1]; k++)
+    {
+      v = nb->adj[k];
+      if (v < u)
+      {
+        for (l = nb->start[v]; l < nb->start[v + 1] && nb->adj[l] != u; l++);
+        if (l < nb->start[v + 1])
+        {
+          continue;
+        }
+      }
+      eu[m] = u;
+      ev[m] = v;
+      edge[m].cost = (long long)nb->len[k] * 1024;
+      if (randomize)
+      {
+        edge[m].cost += (long long)(nb->len[k] * 1024 * INIT_NOISE * rng_unit());
+      }
+      edge[m].idx = m;
+      m++;
+    }
+  }
+  qsort(edge, m, sizeof(Ranked), compare_ranked);
+
+  /* other[v]: the other end of the path ending at v */
+  for (v = 0; v < n; v++)
+  {
+    link[2 * v] = link[2 * v + 1] = -1;
+    deg[v] = 0;
+    other[v] = v;
+  }
+  for (i = 0; i < m; i++)
+  {
+    u = eu[edge[i].idx];
+    v = ev[edge[i].idx];
+    if (deg[u] == 2 || deg[v] == 2 || other[u] == v)
+    {
+      continue;
+    }
+    link[2 * u + deg[u]++] = v;
+    link[2 * v + deg[v]++] = u;
+    a = other[u];
+    b = other[v];
+    other[a] = b;
+    other[b] = a;
+  }
+
+  /* join the paths */
+  alloc_kdset(&S, &vdata->kdtree, 0);
+  for (v = 0; v < n; v++)
+  {
+    if (deg[v] < 2)
+    {
+      kdset_update(&S, v, 1);
+    }
+  }
+  start = vdata->kdtree.perm[0];
+  for (v = 0; v < n; v++)
+  {
+    if (deg[v] < 2)
+    {
+      start = v;
+      break;
+    }
+  }
+  i = 0;
+  u = start;
+  while (u >= 0)
+  {
+    kdset_update(&S, u, -1);
+    kdset_update(&S, other[u], -1);
+    prev = -1;
+    while (u >= 0)
+    {
+      tour[i++] = u;
+      v = fragment_next(link, u, prev);
+      prev = u;
+      u = v;
+    }
+    u = kdset_nearest(&S, tspdata, prev);
+  }
+  free_kdset(&S);
+
+  free(eu);
+  free(ev);
+  free(edge);
+  free(link);
+  free(deg);
+  free(other);
+}
+
+
+/***** initial genes from the constructor param->init; individual 0 gets ***/
+/***** the plain tour and the others random variants for diversity *********/
+void initial_population(int pop, int n, int a[][n], Param *param, TSPdata *tspdata,
+                        Vdata *vdata)
+{
+  int i;
+  int *tour;
+  Ranked *key;
+
+  tour = (int*)malloc_e(n * sizeof(int));
+  key = (Ranked*)malloc_e(n * sizeof(Ranked));
+
+  for (i = 0; i < pop; i++)
+  {
+    switch (param->init)
+    {
+      case INIT_HILBERT:
+        hilbert_tour(n, tour, key, tspdata, i > 0);
+        break;
+      case INIT_NN:
+        nearest_neighbor_tour(n, tour, i > 0 ? rng_below(n) : 0, tspdata, &vdata->kdtree);
+        break;
+      default:
+        greedy_tour(n, tour, tspdata, vdata, i > 0);
+        break;
+    }
+    if (!inject_tour(n, tour, a[i]))
+    {
+      fprintf(stderr, "error: the initial tour %d is not a permutation.\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  free(tour);
+  free(key);
+}
+
+
+/***** let the 3rd best take the place of the 3rd worst as a parent *******/
+void rand_crossover(int pop, int *src)
+{
+  int p;
+  p = 3;
+
+  src[pop-p] = src[p];
+}
+
+
+/***** local search on the routes that have changed since the last *********/
+/***** generation and on the children marked in polish, from their first ****/
+/***** node; the improved routes are encoded back into their genes ***********/
+void improve_population(int pop, int n, int a[][n], int route[][n], long long *fit,
+                        long long *head, int *dirty, int *polish, int *tree, Param *param,
+                        LocalSearch *ls, TSPdata *tspdata, Vdata *vdata)
+{
+  int i;
+
+  if (param->localsearch == LS_NONE)
+  {
+    return;
+  }
+
+  for (i = 0; i < pop; i++)
+  {
+    if ((dirty[i] == n && !polish[i]) || search_time() >= ls->deadline)
     {
-        m = min(d);
-        for (j = 0; j < POPULATION; j++)
-        {
-            if (d[j] == m)
-            {
-                idx = j;
-            }
-        }
+      continue;
+    }
+    local_search(param, ls, tspdata, &vdata->dcache, &vdata->nb, route[i],
+                 polish[i] ? 0 : dirty[i]);
+    encode_gene(n, route[i], a[i], tree);
+    fit[i] = prefix_cost(&vdata->dcache, tspdata, route[i], n, head + i * prefix_stride(n), 0);
+    dirty[i] = n;
+    polish[i] = 0;
+  }
+}
+
+
+/***** keep the best route found so far in vdata->bestsol *******************/
+void update_best(int pop, int n, int route[][n], long long *a, Vdata *vdata)
+{
+  int i, best = 0;
+
+  for (i = 1; i < pop; i++)
+  {
+    if (a[i] < a[best])
+    {
+      best = i;
+    }
+  }
+  if (a[best] < vdata->bestcost)
+  {
+    vdata->bestcost = a[best];
+    memcpy(vdata->bestsol, route[best], n*sizeof(int));
+  }
+}
+
+
+/***** a queue of capacity "slots" for tours of n nodes **********************/
+Channel *alloc_channel(int n, int slots)
+{
+  Channel *c;
+
+  if (posix_memalign((void**)&c, ARENA_ALIGN, sizeof(Channel)) != 0)
+  {
+    fprintf(stderr, "malloc : not enough memory.\n");
+    exit(EXIT_FAILURE);
+  }
+  c->n = n;
+  c->slots = slots;
+  c->route = (int*)malloc_e((size_t)slots * n * sizeof(int));
+  c->cost = (long long*)malloc_e(slots * sizeof(long long));
+  c->head = 0;
+  c->tail = 0;
+  return c;
+}
+
+
+void free_channel(Channel *c)
+{
+  free(c->route);
+  free(c->cost);
+  free(c);
+}
+
+
+/***** the producer appends a tour; it is dropped if the queue is full *****/
+int channel_push(Channel *c, int *route, long long cost)
+{
+  unsigned long tail = c->tail;
+
+  if (tail - __atomic_load_n(&c->head, __ATOMIC_ACQUIRE) == (unsigned long)c->slots)
+  {
+    return 0;
+  }
+  memcpy(c->route + (size_t)(tail % c->slots) * c->n, route, c->n * sizeof(int));
+  c->cost[tail % c->slots] = cost;
+  /* the tour is complete before the consumer can see it */
+  __atomic_store_n(&c->tail, tail + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+
+/***** the consumer looks at the oldest tour, NULL if the queue is empty ***/
+int *channel_front(Channel *c, long long *cost)
+{
+  unsigned long head = c->head;
+
+  if (head == __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE))
+  {
+    return NULL;
+  }
+  *cost = c->cost[head % c->slots];
+  return c->route + (size_t)(head % c->slots) * c->n;
+}
+
+
+/***** the consumer is done with the oldest tour ****************************/
+void channel_pop(Channel *c)
+{
+  __atomic_store_n(&c->head, c->head + 1, __ATOMIC_RELEASE);
+}
+
+
+/***** connect the islands by queues: island i sends to i+1 on a ring; on ***/
+/***** a torus of rows x cols islands it sends to the right and down *******/
+void connect_islands(Island *I, int islands, int topology, int slots, int n)
+{
+  int i, j, k, d, rows = 1, cols, to[2];
+
+  for (i = 0; i < islands; i++)
+  {
+    I[i].nin = 0;
+    I[i].nout = 0;
+  }
+  if (topology == TOPO_TORUS)
+  {
+    for (d = 1; d * d <= islands; d++)
+    {
+      if (islands % d == 0)
+      {
+        rows = d;
+      }
+    }
+  }
+  cols = islands / rows;
+
+  for (i = 0; i < islands; i++)
+  {
+    to[0] = (i / cols) * cols + (i % cols + 1) % cols;
+    to[1] = ((i / cols + 1) % rows) * cols + i % cols;
+    for (k = 0; k < (rows > 1 ? 2 : 1); k++)
+    {
+      j = to[k];
+      if (j == i || (k == 1 && j == to[0]))
+      {
+        continue;
+      }
+      I[i].out[I[i].nout] = alloc_channel(n, slots);
+      I[j].in[I[j].nin++] = I[i].out[I[i].nout++];
+    }
+  }
+}
+
+
+/***** a migrant takes the place of the worst individual if it is shorter ***/
+/***** and its cost is not in the population yet; returns 1 if it is taken ***/
+int accept_migrant(Island *I, int pop, int n, int a[][n], int route[][n], long long *fit,
+                   long long *head, int *dirty, int *tree, int *tour, long long cost)
+{
+  int i, worst = 0, dup = 0;
+  TSPdata *tspdata = I->tspdata;
+
+  for (i = 0; i < pop; i++)
+  {
+    if (fit[i] > fit[worst])
+    {
+      worst = i;
+    }
+    dup |= (fit[i] == cost);
+  }
+  if (cost >= fit[worst] || dup)
+  {
+    return 0;
+  }
+  memcpy(route[worst], tour, n * sizeof(int));
+  encode_gene(n, route[worst], a[worst], tree);
+  fit[worst] = cost;
+  head[worst * prefix_stride(n)] = 0;
+  dirty[worst] = n;
+  I->accepted++;
+  if (I->param.debug > 1 && cost != compute_cost(tspdata, route[worst]))
+  {
+    fprintf(stderr, "error: migrant cost mismatch on island %d.\n", I->id);
+    exit(EXIT_FAILURE);
+  }
+  return 1;
+}
+
+
+/***** every param->migration generations the best param->migrants *********/
+/***** individuals are sent to the next islands; the migrants received ****/
+/***** go through accept_migrant() ******************************************/
+void migrate(Island *I, int pop, int n, int a[][n], int route[][n], long long *fit,
+             long long *head, int *dirty, int *tree, Ranked *rank)
+{
+  int k, c, *tour;
+  long long cost;
+
+  if (I->generations % I->param.migration == 0 && I->nout > 0)
+  {
+    sort_by_cost(pop, fit, rank);
+    for (k = 0; k < I->param.migrants && k < pop; k++)
+    {
+      for (c = 0; c < I->nout; c++)
+      {
+        I->sent += channel_push(I->out[c], route[rank[k].idx], fit[rank[k].idx]);
+      }
+    }
+  }
+
+  for (c = 0; c < I->nin; c++)
+  {
+    while ((tour = channel_front(I->in[c], &cost)) != NULL)
+    {
+      accept_migrant(I, pop, n, a, route, fit, head, dirty, tree, tour, cost);
+      channel_pop(I->in[c]);
+    }
+  }
+}
+
+
+/***** slot k of the shared segment and the tour stored after it ***********/
+ShmSlot *shm_slot(Shared *S, int k)
+{
+  return (ShmSlot*)(S->base + S->stride * k);
+}
+
+
+int *slot_tour(ShmSlot *slot)
+{
+  return (int*)(slot + 1);
+}
+
+
+/***** write a tour under the seqlock of the slot; "exclusive" writers own **/
+/***** the slot, the others take the lock with a compare-and-swap and ******/
+/***** write only a tour shorter than the one in the slot ******************/
+void seqlock_write(ShmSlot *slot, int *tour, long long cost, int n, int exclusive)
+{
+  unsigned long seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+  if (!exclusive)
+  {
+    do
+    {
+      seq &= ~1UL;
+    } while (!__atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, 0,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    if (cost >= slot->cost)
+    {
+      __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+      return;
+    }
+  }
+  else
+  {
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+  }
+  /* the odd sequence number is visible before the tour changes */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(slot_tour(slot), tour, n * sizeof(int));
+  slot->cost = cost;
+  __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+/***** copy the tour of the slot; returns 0 if there is none or no copy *****/
+/***** without a writer in between could be made in SHM_RETRY attempts *****/
+int seqlock_read(ShmSlot *slot, int *tour, long long *cost, int n, unsigned long *seq)
+{
+  unsigned long s1, s2;
+  int k;
+
+  for (k = 0; k < SHM_RETRY; k++)
+  {
+    s1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (s1 & 1)
+    {
+      sched_yield();
+      continue;
+    }
+    *cost = slot->cost;
+    memcpy(tour, slot_tour(slot), n * sizeof(int));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    if (s1 == s2)
+    {
+      *seq = s1;
+      return *cost < LLONG_MAX;
+    }
+  }
+  return 0;
+}
+
+
+/***** a POSIX shared memory segment for "procs" processes; the name is ****/
+/***** removed at once, the processes forked later inherit the mapping *****/
+void open_shared(Shared *S, int procs, int n)
+{
+  char name[MAX_STR];
+  int k, fd;
+
+  S->procs = procs;
+  S->proc = 0;
+  S->n = n;
+  S->seen = 0;
+  S->stride = (sizeof(ShmSlot) + (size_t)n * sizeof(int) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+  S->size = S->stride * (procs + 1);
+  sprintf(name, "/tsp-ga-%d", (int)getpid());
+  fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 || ftruncate(fd, S->size) != 0)
+  {
+    fprintf(stderr, "error: shared memory %s could not be created.\n", name);
+    exit(EXIT_FAILURE);
+  }
+  S->base = (char*)mmap(NULL, S->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  shm_unlink(name);
+  if (S->base == MAP_FAILED)
+  {
+    fprintf(stderr, "error: shared memory %s could not be mapped.\n", name);
+    exit(EXIT_FAILURE);
+  }
+  for (k = 0; k <= procs; k++)
+  {
+    shm_slot(S, k)->seq = 0;
+    shm_slot(S, k)->cost = LLONG_MAX;
+  }
+  S->tour = (int*)malloc_e(n * sizeof(int));
+}
+
+
+/***** pin the calling process to the cpus of NUMA node proc mod (number **/
+/***** of nodes) as listed in sysfs; nothing is done without the list *****/
+void pin_numa_node(int proc)
+{
+  char path[MAX_STR], list[MAX_STR], *p;
+  int nodes = 0, lo, hi, c;
+  cpu_set_t set;
+  FILE *fp;
+
+  for (;;)
+  {
+    sprintf(path, "/sys/devices/system/node/node%d/cpulist", nodes);
+    if ((fp = fopen(path, "r")) == NULL)
+    {
+      break;
+    }
+    fclose(fp);
+    nodes++;
+  }
+  if (nodes == 0)
+  {
+    return;
+  }
+  sprintf(path, "/sys/devices/system/node/node%d/cpulist", proc % nodes);
+  if ((fp = fopen(path, "r")) == NULL || fgets(list, MAX_STR, fp) == NULL)
+  {
+    if (fp != NULL)
+    {
+      fclose(fp);
+    }
+    return;
+  }
+  fclose(fp);
+
+  /* the list looks like "0-15,32-47" */
+  CPU_ZERO(&set);
+  for (p = list; *p >= '0' && *p <= '9'; )
+  {
+    lo = hi = (int)strtol(p, &p, 10);
+    if (*p == '-')
+    {
+      hi = (int)strtol(p + 1, &p, 10);
+    }
+    for (c = lo; c <= hi && c < CPU_SETSIZE; c++)
+    {
+      CPU_SET(c, &set);
+    }
+    if (*p == ',')
+    {
+      p++;
+    }
+  }
+  if (CPU_COUNT(&set) > 0)
+  {
+    sched_setaffinity(0, sizeof(set), &set);
+  }
+}
+
+
+/***** start processes 1..procs-1 as copies of this one; returns the *****/
+/***** number of the calling process ****************************************/
+int fork_processes(Shared *S, pid_t *pid, int numa)
+{
+  int p;
+
+  fflush(stdout);
+  for (p = 1; p < S->procs; p++)
+  {
+    if ((pid[p] = fork()) < 0)
+    {
+      fprintf(stderr, "error: process %d could not be started.\n", p);
+      exit(EXIT_FAILURE);
+    }
+    if (pid[p] == 0)
+    {
+      S->proc = p;
+      break;
+    }
+  }
+  if (numa)
+  {
+    pin_numa_node(S->proc);
+  }
+  return S->proc;
+}
+
+
+/***** the best individual is published in the slot of this process and ***/
+/***** in the global best slot; the tour of the previous process on the ****/
+/***** ring is taken as a migrant if it is new ******************************/
+void exchange_shared(Island *I, int pop, int n, int a[][n], int route[][n], long long *fit,
+                     long long *head, int *dirty, int *tree)
+{
+  Shared *S = I->shm;
+  int i, best = 0;
+  long long cost;
+  unsigned long seq;
+
+  for (i = 1; i < pop; i++)
+  {
+    if (fit[i] < fit[best])
+    {
+      best = i;
+    }
+  }
+  seqlock_write(shm_slot(S, 1 + S->proc), route[best], fit[best], n, 1);
+  seqlock_write(shm_slot(S, 0), route[best], fit[best], n, 0);
+  I->sent++;
+
+  if (seqlock_read(shm_slot(S, 1 + (S->proc + S->procs - 1) % S->procs), S->tour, &cost, n, &seq)
+      && seq != S->seen)
+  {
+    S->seen = seq;
+    accept_migrant(I, pop, n, a, route, fit, head, dirty, tree, S->tour, cost);
+  }
+}
+
+
+/***** little-endian words and variable-length integers of the frames ******/
+void put_u32(unsigned char *p, unsigned long v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+
+unsigned long get_u32(const unsigned char *p)
+{
+  return (unsigned long)p[0] | (unsigned long)p[1] << 8 | (unsigned long)p[2] << 16
+         | (unsigned long)p[3] << 24;
+}
+
+
+int put_varint(unsigned char *p, unsigned long v)
+{
+  int k = 0;
+
+  while (v >= 0x80)
+  {
+    p[k++] = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  p[k++] = v;
+  return k;
+}
+
+
+int varint_len(unsigned long v)
+{
+  int k = 1;
+
+  while (v >= 0x80)
+  {
+    v >>= 7;
+    k++;
+  }
+  return k;
+}
+
+
+/***** returns the number of bytes read, 0 if the integer does not end *****/
+/***** before "end" or does not fit in 32 bits ******************************/
+int get_varint(const unsigned char *p, const unsigned char *end, unsigned long *v)
+{
+  int k;
+
+  *v = 0;
+  for (k = 0; k < 5 && p + k < end; k++)
+  {
+    *v |= (unsigned long)(p[k] & 0x7f) << (7 * k);
+    if (!(p[k] & 0x80))
+    {
+      return *v <= 0xffffffffUL ? k + 1 : 0;
+    }
+  }
+  return 0;
+}
+
+
+/***** differences of node numbers, small ones of either sign in few bytes **/
+unsigned long zigzag(long d)
+{
+  return d >= 0 ? 2 * (unsigned long)d : 2 * (unsigned long)(-d) - 1;
+}
+
+
+long unzigzag(unsigned long v)
+{
+  return (v & 1) ? -(long)((v + 1) / 2) : (long)(v / 2);
+}
+
+
+/***** adj[2k] and adj[2k+1] are the two neighbours of node k on the tour ***/
+void tour_neighbors(int n, int *tour, int *adj)
+{
+  int k;
+
+  for (k = 0; k < n; k++)
+  {
+    adj[2 * tour[k]] = tour[k == 0 ? n - 1 : k - 1];
+    adj[2 * tour[k] + 1] = tour[k == n - 1 ? 0 : k + 1];
+  }
+}
 
-        for (j = 0; j < n; j++)
-        {
-            c[i][j] = b[idx][j];
-        }
-        d[idx] = 1000000;
+
+/***** the frame of a tour for link L: the whole tour as differences of ****/
+/***** consecutive nodes, or the nodes whose neighbours differ from the ****/
+/***** last tour sent on L (which the receiver holds) if they are few ******/
+void encode_frame(Network *N, NetLink *L, int *tour, long long cost)
+{
+  int n = N->n, k, v, prev, changed = 0, *old = N->adj, *adj = N->adj + 2 * n;
+  unsigned char *p = L->buf + NET_HEADER;
+  long long full = NET_HEADER;
+
+  for (k = 0; k < n; k++)
+  {
+    full += varint_len(k == 0 ? (unsigned long)tour[0] : zigzag(tour[k] - tour[k - 1]));
+  }
+  if (L->cost < LLONG_MAX)
+  {
+    tour_neighbors(n, L->base, old);
+    tour_neighbors(n, tour, adj);
+    for (v = 0; v < n; v++)
+    {
+      changed += !((adj[2 * v] == old[2 * v] && adj[2 * v + 1] == old[2 * v + 1])
+                   || (adj[2 * v] == old[2 * v + 1] && adj[2 * v + 1] == old[2 * v]));
     }
+  }
 
+  if (L->cost < LLONG_MAX && 3 * changed < n)
+  {
+    put_u32(L->buf + 4, NET_DELTA);
+    N->deltas++;
+    p += put_varint(p, changed);
+    for (v = 0, prev = -1; v < n; v++)
+    {
+      if (!((adj[2 * v] == old[2 * v] && adj[2 * v + 1] == old[2 * v + 1])
+            || (adj[2 * v] == old[2 * v + 1] && adj[2 * v + 1] == old[2 * v])))
+      {
+        p += put_varint(p, v - prev - 1);
+        p += put_varint(p, zigzag(adj[2 * v] - v));
+        p += put_varint(p, zigzag(adj[2 * v + 1] - v));
+        prev = v;
+      }
+    }
+  }
+  else
+  {
+    put_u32(L->buf + 4, NET_FULL);
+    p += put_varint(p, tour[0]);
+    for (k = 1; k < n; k++)
+    {
+      p += put_varint(p, zigzag(tour[k] - tour[k - 1]));
+    }
+  }
+  put_u32(L->buf, NET_MAGIC);
+  put_u32(L->buf + 8, n);
+  put_u32(L->buf + 12, p - L->buf - NET_HEADER);
+  put_u32(L->buf + 16, (unsigned long long)cost & 0xffffffffULL);
+  put_u32(L->buf + 20, (unsigned long long)cost >> 32);
+  L->len = p - L->buf;
+  L->done = 0;
+  memcpy(L->base, tour, n * sizeof(int));
+  L->cost = cost;
+  N->frames++;
+  N->bytes += L->len;
+  N->full_bytes += full;
 }
 
 
-void tow_point_crossover(int n, int a[][n], int b[][n])   
+/***** the tour of a whole frame of link L into N->tour; returns 0 if the ***/
+/***** frame is not a tour of n nodes, then the link has to be closed *******/
+int decode_frame(Network *N, NetLink *L, const unsigned char *frame, long long *cost)
 {
-  int i, j, point;
-    
-  if ((n % 2) == 0)
+  int n = N->n, k, v, prev, cur, next, *adj = N->adj, *mark = N->adj + 2 * n;
+  unsigned long kind = get_u32(frame + 4), x, count, a, b;
+  const unsigned char *p = frame + NET_HEADER, *end = p + get_u32(frame + 12);
+  int r;
+
+  if (get_u32(frame + 8) != (unsigned long)n || (kind == NET_DELTA && L->cost == LLONG_MAX))
   {
-    point = (n / 2) - 1;
-  }else
+    return 0;
+  }
+  *cost = (long long)(get_u32(frame + 16) | (unsigned long long)get_u32(frame + 20) << 32);
+  memset(mark, 0, n * sizeof(int));
+
+  if (kind == NET_FULL)
   {
-    point = ((n + 1)/2) - 1;
-  }  
-    
-  for (i = 0; i < POPULATION; i=i+2)
+    for (k = 0, v = 0; k < n; k++)
+    {
+      if ((r = get_varint(p, end, &x)) == 0)
+      {
+        return 0;
+      }
+      p += r;
+      v = k == 0 ? (long)x : v + unzigzag(x);
+      if (v < 0 || v >= n || mark[v])
+      {
+        return 0;
+      }
+      mark[v] = 1;
+      N->tour[k] = v;
+    }
+    return p == end;
+  }
+  if (kind != NET_DELTA)
   {
-    for (j = 0; j < (point/2) + 1; j++)
+    return 0;
+  }
+
+  tour_neighbors(n, L->base, adj);
+  if ((r = get_varint(p, end, &count)) == 0 || count > (unsigned long)n)
+  {
+    return 0;
+  }
+  p += r;
+  for (k = 0, prev = -1; k < (int)count; k++)
+  {
+    if ((r = get_varint(p, end, &x)) == 0 || x >= (unsigned long)(n - prev - 1))
     {
-      a[i][j] = b[i][j];
-      a[i + 1][j] = b[i + 1][j];
+      return 0;
     }
-    
-    for (j = (point/2) + 1; j < (point + (point/2)) + 1; j++)
+    p += r;
+    v = prev + 1 + (int)x;
+    if ((r = get_varint(p, end, &a)) == 0)
+    {
+      return 0;
+    }
+    p += r;
+    if ((r = get_varint(p, end, &b)) == 0)
+    {
+      return 0;
+    }
+    p += r;
+    adj[2 * v] = v + unzigzag(a);
+    adj[2 * v + 1] = v + unzigzag(b);
+    if (adj[2 * v] < 0 || adj[2 * v] >= n || adj[2 * v + 1] < 0 || adj[2 * v + 1] >= n)
     {
-      a[i][j] = b[i + 1][j];
-      a[i + 1][j] = b[i][j];
+      return 0;
     }
+    prev = v;
+  }
+  if (p != end)
+  {
+    return 0;
+  }
 
-    for (j = (point + (point/2)) + 1; j < n; j++)
+  /* walk the neighbours from node 0; they must form one cycle of n nodes */
+  prev = adj[0];
+  cur = 0;
+  mark[0] = 1;
+  N->tour[0] = 0;
+  for (k = 1; k < n; k++)
+  {
+    next = adj[2 * cur] == prev ? adj[2 * cur + 1] : adj[2 * cur];
+    if (mark[next] || (adj[2 * next] != cur && adj[2 * next + 1] != cur))
     {
-      a[i][j] = b[i][j];
-      a[i + 1][j] = b[i + 1][j];
+      return 0;
     }
+    mark[next] = 1;
+    N->tour[k] = next;
+    prev = cur;
+    cur = next;
   }
-    
+  return cur == adj[0] && (adj[2 * cur] == 0 || adj[2 * cur + 1] == 0);
 }
 
 
-void mutation(int n, int a[][n])
+/***** a link with room for the largest frame of n nodes *******************/
+void init_link(NetLink *L, int n)
 {
-  int i, point, r = rand() % (POPULATION - 1) + 1;
+  L->fd = -1;
+  L->connecting = 0;
+  L->addrlen = 0;
+  L->cap = NET_HEADER + 5 * (size_t)n + 16;
+  L->buf = (unsigned char*)malloc_e(L->cap);
+  L->len = L->done = 0;
+  L->base = (int*)malloc_e(n * sizeof(int));
+  L->cost = LLONG_MAX;
+}
 
-  if ((n % 2) == 0)
+
+/***** the last tour on a closed link is lost, so the next one is whole ****/
+void close_link(NetLink *L)
+{
+  if (L->fd >= 0)
   {
-    point = (n / 2);
-  }else
+    close(L->fd);
+  }
+  L->fd = -1;
+  L->connecting = 0;
+  L->len = L->done = 0;
+  L->cost = LLONG_MAX;
+}
+
+
+/***** the socket on param->port and the addresses of param->peers *********/
+void open_network(Network *N, Param *param, int n)
+{
+  char list[MAX_STR], *item, *colon, *save;
+  struct sockaddr_in any;
+  struct addrinfo hints, *res;
+  int one = 1;
+
+  N->n = n;
+  N->listen_fd = -1;
+  N->nout = N->nin = 0;
+  N->out = (NetLink*)malloc_e((strlen(param->peers) / 2 + 1) * sizeof(NetLink));
+  N->in = NULL;
+  N->tour = (int*)malloc_e(n * sizeof(int));
+  N->adj = (int*)malloc_e(4 * (size_t)n * sizeof(int));
+  N->frames = N->deltas = N->bytes = N->full_bytes = N->received = N->rejected = N->accepted = 0;
+
+  if (param->port > 0)
   {
-    point = ((n + 1)/2);
-  }  
-  
-  if (r > (POPULATION/2))
+    memset(&any, 0, sizeof(any));
+    any.sin_family = AF_INET;
+    any.sin_addr.s_addr = htonl(INADDR_ANY);
+    any.sin_port = htons(param->port);
+    if ((N->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0
+        || setsockopt(N->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0
+        || bind(N->listen_fd, (struct sockaddr*)&any, sizeof(any)) != 0
+        || listen(N->listen_fd, 16) != 0)
+    {
+      fprintf(stderr, "error: port %d could not be opened.\n", param->port);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  strcpy(list, param->peers);
+  for (item = strtok_r(list, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
   {
-    for (i = 0; i < point; i++)
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((colon = strrchr(item, ':')) == NULL)
+    {
+      fprintf(stderr, "error: peer %s has no port.\n", item);
+      exit(EXIT_FAILURE);
+    }
+    *colon = '\0';
+    if (getaddrinfo(item, colon + 1, &hints, &res) != 0)
+    {
+      fprintf(stderr, "error: peer %s:%s could not be resolved.\n", item, colon + 1);
+      exit(EXIT_FAILURE);
+    }
+    init_link(&N->out[N->nout], n);
+    memcpy(&N->out[N->nout].addr, res->ai_addr, res->ai_addrlen);
+    N->out[N->nout].addrlen = res->ai_addrlen;
+    N->nout++;
+    freeaddrinfo(res);
+  }
+}
+
+
+void close_network(Network *N)
+{
+  int c;
+
+  if (N->listen_fd >= 0)
   {
-    a[r][i] = 1;
+    close(N->listen_fd);
+  }
+  for (c = 0; c < N->nout; c++)
+  {
+    close_link(&N->out[c]);
+    free(N->out[c].buf);
+    free(N->out[c].base);
   }
-  a[r][point] = 2;
+  for (c = 0; c < N->nin; c++)
+  {
+    close_link(&N->in[c]);
+    free(N->in[c].buf);
+    free(N->in[c].base);
+  }
+  free(N->out);
+  free(N->in);
+  free(N->tour);
+  free(N->adj);
+}
 
-  }else
+
+/***** returns 1 if the link to the peer is connected; a closed link is ****/
+/***** connected again without waiting, a refused one is retried later *****/
+int link_ready(NetLink *L)
+{
+  struct pollfd pfd;
+  int err, one = 1;
+  socklen_t len = sizeof(err);
+
+  if (L->fd < 0)
   {
-    for (i = point; i < n-10; i++)
+    if ((L->fd = socket(L->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0)
     {
-      a[r][i] = 1;
+      return 0;
+    }
+    setsockopt(L->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(L->fd, (struct sockaddr*)&L->addr, L->addrlen) == 0)
+    {
+      return 1;
+    }
+    if (errno != EINPROGRESS)
+    {
+      close_link(L);
+      return 0;
     }
-    a[r][point+10] = 2;
+    L->connecting = 1;
   }
-  
+  if (L->connecting)
+  {
+    pfd.fd = L->fd;
+    pfd.events = POLLOUT;
+    if (poll(&pfd, 1, 0) <= 0)
+    {
+      return 0;
+    }
+    if (getsockopt(L->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+    {
+      close_link(L);
+      return 0;
+    }
+    L->connecting = 0;
+  }
+  return 1;
 }
 
 
-void rand_crossover(int n, int a[][n])
+/***** sends as much of the pending frame as the socket takes now **********/
+void flush_link(NetLink *L)
 {
-  int i, p;
-  p = 3;
+  ssize_t r;
 
-  for (i = 0; i < n; i++)
+  while (L->done < L->len)
   {
-    a[POPULATION-p][i] = a[p][i];
+    r = send(L->fd, L->buf + L->done, L->len - L->done, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (r < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      {
+        close_link(L);
+      }
+      return;
+    }
+    L->done += r;
   }
-  
+  L->len = L->done = 0;
 }
 
 
-void genetic_algorithm( Param *param, TSPdata *tspdata, Vdata *vdata )
+/***** the best tour is sent to every peer when it is shorter than the ****/
+/***** last one sent there; the whole frames received from the other *****/
+/***** nodes are decoded and taken as migrants. nothing here waits *********/
+void exchange_network(Island *I, int pop, int n, int a[][n], int route[][n], long long *fit,
+                      long long *head, int *dirty, int *tree)
 {
-  srand((unsigned int)time(NULL));
+  Network *N = I->net;
+  Vdata *vdata = &I->vdata;
+  NetLink *L;
+  int c, fd;
+  ssize_t r;
+  size_t size;
+  long long cost;
+
+  for (c = 0; c < N->nout; c++)
+  {
+    L = &N->out[c];
+    if (!link_ready(L))
+    {
+      continue;
+    }
+    flush_link(L);
+    if (L->fd >= 0 && L->len == 0 && vdata->bestcost < L->cost)
+    {
+      encode_frame(N, L, vdata->bestsol, vdata->bestcost);
+      flush_link(L);
+    }
+  }
+
+  while (N->listen_fd >= 0
+         && (fd = accept4(N->listen_fd, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+  {
+    N->in = (NetLink*)realloc(N->in, (N->nin + 1) * sizeof(NetLink));
+    if (N->in == NULL)
+    {
+      fprintf(stderr, "realloc : not enough memory.\n");
+      exit(EXIT_FAILURE);
+    }
+    init_link(&N->in[N->nin], n);
+    N->in[N->nin++].fd = fd;
+  }
 
-  int i, len, r1, r2;
+  for (c = 0; c < N->nin; c++)
+  {
+    L = &N->in[c];
+    while (L->fd >= 0)
+    {
+      r = recv(L->fd, L->buf + L->len, L->cap - L->len, MSG_DONTWAIT);
+      if (r <= 0)
+      {
+        if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+          close_link(L);
+        }
+        break;
+      }
+      L->len += r;
+      while (L->fd >= 0 && L->len >= NET_HEADER)
+      {
+        size = NET_HEADER + get_u32(L->buf + 12);
+        if (get_u32(L->buf) != NET_MAGIC || size > L->cap)
+        {
+          N->rejected++;
+          close_link(L);
+          break;
+        }
+        if (L->len < size)
+        {
+          break;
+        }
+        if (!decode_frame(N, L, L->buf, &cost))
+        {
+          N->rejected++;
+          close_link(L);
+          break;
+        }
+        memcpy(L->base, N->tour, n * sizeof(int));
+        L->cost = cost;
+        /* another instance or numbering gives another length */
+        if (route_cost(&vdata->dcache, I->tspdata, N->tour) == cost)
+        {
+          N->received++;
+          N->accepted += accept_migrant(I, pop, n, a, route, fit, head, dirty, tree, N->tour, cost);
+        }
+        else
+        {
+          N->rejected++;
+        }
+        memmove(L->buf, L->buf + size, L->len - size);
+        L->len -= size;
+      }
+    }
+  }
 
+  /* the links closed by the other nodes are dropped */
+  for (c = 0; c < N->nin; )
+  {
+    if (N->in[c].fd < 0)
+    {
+      free(N->in[c].buf);
+      free(N->in[c].base);
+      N->in[c] = N->in[--N->nin];
+    }
+    else
+    {
+      c++;
+    }
+  }
+}
+
+
+/***** the genetic algorithm on one island until its time budget is used ***/
+/***** up; the best route is left in I->vdata.bestsol ***********************/
+void *run_island(void *arg)
+{
+  Island *I = (Island*)arg;
+  Param *param = &I->param;
+  TSPdata *tspdata = I->tspdata;
+  Vdata *vdata = &I->vdata;
+  int i, len, pop, r1, r2, given = 0;
+  double t, deadline;
+  Population P;
+  LocalSearch *ls = &I->ls;
+  Operator *op = I->op;
+  Recomb R;
+
+  deadline = I->deadline;
+  /* island i draws from stream i of the seed of this node, in every
+     process */
+  rng_seed(param->seed ^ I->node, I->id);
   len = tspdata->n;
+  pop = param->population;
+#ifdef _OPENMP
+  if (param->islands > 1 || (param->processes > 1 && param->threads == 0))
+  {
+    /* the islands or the processes already keep the cores busy */
+    omp_set_num_threads(1);
+  }
+  else if (param->threads > 0)
+  {
+    omp_set_num_threads(param->threads);
+  }
+#endif
+  alloc_population(&P, pop, len, max_threads());
+
+  int (*gene)[len] = (int (*)[len])P.gene_a, (*gene_new)[len] = (int (*)[len])P.gene_b, (*gene_swap)[len];
+  int (*route)[len] = (int (*)[len])P.route_a, (*route_new)[len] = (int (*)[len])P.route_b, (*route_swap)[len];
+  long long *fitness = P.fitness, *head = P.head_a, *head_new = P.head_b, *head_swap;
+  int *dirty = P.dirty, *polish = P.polish, *src = P.src;
 
-  int gene[POPULATION][len], route[POPULATION][len], fitness[POPULATION], gene_tmp[POPULATION][len];
+  for (i = 0; i < pop; i++)
+  {
+    dirty[i] = 0;
+    polish[i] = 0;
+    head[i * prefix_stride(len)] = 0;
+  }
 
-  create_matrix(len, gene);
+  create_matrix(pop, len, gene);
+  init_operators(op);
+  if (param->crossover != CX_TWOPOINT)
+  {
+    alloc_recomb(&R, len, param->crossover);
+    R.eax.deadline = deadline;
+  }
 
-  for (i = 0; i < len; i++)
+  alloc_local_search(ls, len, param->twolevel > 0 && len >= param->twolevel);
+  ls->deadline = deadline;
+  if (param->init != INIT_IDENTITY)
   {
-    gene[0][i] = 1;
+    t = thread_time();
+    initial_population(pop, len, gene, param, tspdata, vdata);
+    if (param->debug && I->id == 0)
+    {
+      printf("initial tours: %d in %.2f seconds\n", pop, thread_time() - t);
+    }
   }
 
-  for(i=0; i<tspdata->n; i++){
-    vdata->bestsol[i] = i;
+  /* the given (or, without a constructor, the identity) tour is improved
+     and becomes gene[0] of the first island */
+  if (I->id == 0 && (param->givesol == 1 || param->init == INIT_IDENTITY)
+      && is_feasible(tspdata, vdata->bestsol))
+  {
+    local_search(param, ls, tspdata, &vdata->dcache, &vdata->nb, vdata->bestsol, 0);
+    given = inject_tour(len, vdata->bestsol, gene[0]);
+  }
+  if (!given && param->init == INIT_IDENTITY)
+  {
+    for (i = 0; i < len; i++)
+    {
+      gene[0][i] = 1;
     }
-  while(cpu_time() - vdata->starttime < param->timelim){
-  order_representation(len, gene, route);
-  evaluate_route(len, route, fitness, tspdata);
-  ranking_selection(fitness, len, gene, gene_tmp);
+  }
+  vdata->bestcost = LLONG_MAX;
+
+  if (param->debug && I->id == 0)
+  {
+    check_decoder(pop, len, gene);
+    check_dist_cache(&vdata->dcache, tspdata);
+    order_representation(pop, len, gene, route, dirty, P.tree);
+    check_tour_length(&vdata->dcache, tspdata, route[0], pop);
+    check_neighbors(tspdata, &vdata->nb, param->quadrant);
+    check_two_level(len);
+    check_rng();
+  }
+
+  /* selection only ranks the handles in src, crossover writes the next
+     generation into the other buffers and then the buffers are swapped;
+     every island evaluates at least one generation, even if the others
+     have used up the shared deadline while it built its initial tours */
+  while(I->generations == 0 || search_time() < deadline){
+  order_representation(pop, len, gene, route, dirty, P.tree);
+  improve_population(pop, len, gene, route, fitness, head, dirty, polish, P.tree, param, ls, tspdata, vdata);
+  evaluate_route(pop, len, route, fitness, head, dirty, tspdata, &vdata->dcache, param->debug);
+  update_best(pop, len, route, fitness, vdata);
+  I->generations++;
+  if (I->nin + I->nout > 0)
+  {
+    migrate(I, pop, len, gene, route, fitness, head, dirty, P.tree, P.rank);
+  }
+  if (I->shm != NULL && I->generations % param->migration == 0)
+  {
+    exchange_shared(I, pop, len, gene, route, fitness, head, dirty, P.tree);
+  }
+  if (I->net != NULL && I->generations % param->migration == 0)
+  {
+    exchange_network(I, pop, len, gene, route, fitness, head, dirty, P.tree);
+  }
+  select_parents(param, pop, fitness, src, P.rank);
 
-  r1 = rand() % (20);
-  r2 = rand() % (20);
+  r1 = rng_below(20);
+  r2 = rng_below(20);
 
   if (r1 == 7)
   {
-    rand_crossover(len, gene_tmp);
+    rand_crossover(pop, src);
   }
 
 
-  tow_point_crossover(len, gene, gene_tmp);
+  if (param->crossover != CX_TWOPOINT)
+  {
+    route_crossover(pop, len, gene_new, route_new, route, src, dirty, polish, fitness, head, P.tree,
+                    param, op, &R, tspdata, vdata);
+  }
+  else
+  {
+    tow_point_crossover(pop, len, gene_new, gene, src, dirty);
+  }
 
   if (r1 ==  r2)
   {
-    mutation(len, gene);
+    t = thread_time();
+    mutation(pop, len, gene_new, dirty);
+    I->mutation_time += thread_time() - t;
+    I->mutations++;
+  }
+
+  if (param->crossover == CX_TWOPOINT)
+  {
+    inherit_routes(pop, len, route, route_new, src, dirty, fitness, head, head_new);
+    head_swap = head;
+    head = head_new;
+    head_new = head_swap;
   }
+  gene_swap = gene;
+  gene = gene_new;
+  gene_new = gene_swap;
+  route_swap = route;
+  route = route_new;
+  route_new = route_swap;
   
   }
 
-  order_representation(len, gene_tmp, route);
-  for (i = 0; i < len; i++)
+  free_population(&P);
+  free_local_search(ls);
+  if (param->crossover != CX_TWOPOINT)
   {
-    vdata->bestsol[i] = route[0][i] - 1;
+    free_recomb(&R, param->crossover);
   }
-
+  return NULL;
 }
 
 
+/***** the search on param->islands islands, one thread each, which ********/
+/***** exchange their best individuals; the best island gives bestsol. *****/
+/***** with param->processes > 1 the process is forked after the shared ****/
+/***** data is prepared, and the processes exchange their best tours *******/
+/***** through shared memory; the first process reports the global best ****/
+/***** and, with param->port or param->peers, sends and receives tours ******/
+/***** of the other nodes over TCP ******************************************/
+void genetic_algorithm( Param *param, TSPdata *tspdata, Vdata *vdata )
+{
+  int i, k, len, islands, proc = 0, status, best = 0;
+  long long cost;
+  unsigned long seq;
+  unsigned long long node;
+  Shared S;
+  Network N, *net = NULL;
+  pid_t *pid = NULL;
+  long long mutations = 0, moves = 0, or_moves = 0, lk_moves = 0, children, improved;
+  double budget, ls_time = 0, mutation_time = 0, cx_time;
+  Island *I;
+  pthread_t *th;
+
+  len = tspdata->n;
+  islands = param->islands > 1 ? param->islands : 1;
+  if (param->seed == 0)
+  {
+    param->seed = ((unsigned long long)time(NULL) << 20) ^ (unsigned long long)getpid();
+  }
+  node = node_key(param);
+  select_rng_kernel(param);
+
+  prepare_dist_cache(param, tspdata, &vdata->dcache);
+  select_tour_length_kernel(param, &vdata->dcache);
+  prepare_kdtree(tspdata, &vdata->kdtree);
+  if (vdata->nb.adj == NULL)
+  {
+    prepare_neighbors(param, tspdata, &vdata->kdtree, &vdata->nb);
+  }
+  if (param->cachefile[0] != '\0' && !vdata->cached)
+  {
+    write_instance_cache(param, tspdata, vdata);
+  }
+
+  /* timelim bounds the cpu time of the whole process: all islands stop
+     at the same deadline on search_time(), which also counts the threads
+     of the parallel loops and the time spent in the kernel; the
+     processes share it equally, each on its own clock, which starts from
+     zero in a forked child */
+  budget = param->timelim - (cpu_time() - vdata->starttime);
+  if (param->processes > 1)
+  {
+    open_shared(&S, param->processes, len);
+    pid = (pid_t*)malloc_e(param->processes * sizeof(pid_t));
+    proc = fork_processes(&S, pid, param->numa);
+    budget /= param->processes;
+  }
+  /* the first process talks to the other nodes */
+  if (proc == 0 && (param->port > 0 || param->peers[0] != '\0'))
+  {
+    open_network(&N, param, len);
+    net = &N;
+  }
+  I = (Island*)malloc_e(islands * sizeof(Island));
+  th = (pthread_t*)malloc_e(islands * sizeof(pthread_t));
+  for (i = 0; i < islands; i++)
+  {
+    I[i].id = proc * islands + i;
+    I[i].param = *param;
+    if (param->islandmix)
+    {
+      I[i].param.selection = (param->selection + i) % SEL_NUM;
+    }
+    I[i].tspdata = tspdata;
+    I[i].vdata = *vdata;
+    I[i].vdata.bestsol = (int*)malloc_e(len * sizeof(int));
+    memcpy(I[i].vdata.bestsol, vdata->bestsol, len * sizeof(int));
+    I[i].deadline = search_time() + budget;
+    I[i].node = node;
+    I[i].mutations = 0;
+    I[i].mutation_time = 0;
+    I[i].generations = 0;
+    I[i].sent = 0;
+    I[i].accepted = 0;
+    I[i].shm = (param->processes > 1 && i == 0) ? &S : NULL;
+    I[i].net = i == 0 ? net : NULL;
+  }
+  connect_islands(I, islands, param->topology, CHANNEL_SLOTS * param->migrants, len);
+
+  /* island 0 runs in this thread */
+  for (i = 1; i < islands; i++)
+  {
+    if (pthread_create(&th[i], NULL, run_island, &I[i]) != 0)
+    {
+      fprintf(stderr, "error: island %d could not be started.\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+  run_island(&I[0]);
+  for (i = 1; i < islands; i++)
+  {
+    pthread_join(th[i], NULL);
+  }
+
+  for (i = 1; i < islands; i++)
+  {
+    if (I[i].vdata.bestcost < I[best].vdata.bestcost)
+    {
+      best = i;
+    }
+  }
+  if (I[best].vdata.bestcost < LLONG_MAX)
+  {
+    vdata->bestcost = I[best].vdata.bestcost;
+    memcpy(vdata->bestsol, I[best].vdata.bestsol, len * sizeof(int));
+  }
+
+  /* the other processes leave their best tours in the segment and exit,
+     the first one takes the global best */
+  if (param->processes > 1)
+  {
+    if (vdata->bestcost < LLONG_MAX)
+    {
+      seqlock_write(shm_slot(&S, 1 + proc), vdata->bestsol, vdata->bestcost, len, 1);
+      seqlock_write(shm_slot(&S, 0), vdata->bestsol, vdata->bestcost, len, 0);
+    }
+    if (proc > 0)
+    {
+      _exit(EXIT_SUCCESS);
+    }
+    for (i = 1; i < param->processes; i++)
+    {
+      if (waitpid(pid[i], &status, 0) != pid[i] || !WIFEXITED(status)
+          || WEXITSTATUS(status) != EXIT_SUCCESS)
+      {
+        fprintf(stderr, "warning: process %d did not finish normally.\n", i);
+      }
+    }
+    if (seqlock_read(shm_slot(&S, 0), S.tour, &cost, len, &seq) && cost < vdata->bestcost)
+    {
+      vdata->bestcost = cost;
+      memcpy(vdata->bestsol, S.tour, len * sizeof(int));
+    }
+    if (param->debug)
+    {
+      for (i = 0; i < param->processes; i++)
+      {
+        cost = shm_slot(&S, 1 + i)->cost;
+        printf("process %d: best %lld\n", i, cost);
+      }
+    }
+    munmap(S.base, S.size);
+    free(S.tour);
+    free(pid);
+  }
+  if (net != NULL)
+  {
+    if (param->debug)
+    {
+      printf("network: %lld tours sent (%lld as deltas) in %lld bytes (%lld as whole tours), %lld received, %lld rejected, %lld accepted\n",
+             N.frames, N.deltas, N.bytes, N.full_bytes, N.received, N.rejected, N.accepted);
+    }
+    close_network(&N);
+  }
+
+  if (param->debug)
+  {
+    printf("seed: %llu, node key: %016llx\n", param->seed, node);
+    for (i = 0; i < islands; i++)
+    {
+      moves += I[i].ls.moves;
+      or_moves += I[i].ls.or_moves;
+      lk_moves += I[i].ls.lk_moves;
+      ls_time += I[i].ls.time;
+      mutations += I[i].mutations;
+      mutation_time += I[i].mutation_time;
+      if (islands > 1)
+      {
+        printf("island %d: %lld generations, best %lld, %lld migrants sent, %lld accepted\n",
+               i, I[i].generations, I[i].vdata.bestcost, I[i].sent, I[i].accepted);
+      }
+    }
+    printf("local search: %lld 2-opt, %lld Or-opt and %lld LK moves in %.2f seconds (%.0f moves/s)\n",
+           moves, or_moves, lk_moves, ls_time,
+           ls_time > 0 ? (moves + or_moves + lk_moves) / ls_time : 0.0);
+    printf("mutation: %lld calls in %.2f seconds (%.0f calls/s)\n",
+           mutations, mutation_time, mutation_time > 0 ? mutations / mutation_time : 0.0);
+    for (k = 1; k < CX_NUM; k++)
+    {
+      children = improved = 0;
+      cx_time = 0;
+      for (i = 0; i < islands; i++)
+      {
+        children += I[i].op[k].children;
+        improved += I[i].op[k].improved;
+        cx_time += I[i].op[k].time;
+      }
+      if (children > 0)
+      {
+        printf("crossover %s: %lld children in %.2f seconds (%.0f children/s), %.1f%% shorter than both parents\n",
+               I[0].op[k].name, children, cx_time, cx_time > 0 ? children / cx_time : 0.0,
+               100.0 * improved / children);
+      }
+    }
+  }
+
+  for (i = 0; i < islands; i++)
+  {
+    for (k = 0; k < I[i].nout; k++)
+    {
+      free_channel(I[i].out[k]);
+    }
+    free(I[i].vdata.bestsol);
+  }
+  free(I);
+  free(th);
+}
+
 
 /***** main ******************************************************************/
 int main(int argc, char *argv[]){
@@ -623,7 +6124,11 @@ int main(int argc, char *argv[]){
 
   vdata.timebrid = cpu_time();
   copy_parameters(argc, argv, &param);
-  read_tspfile(stdin,&tspdata,&vdata);
+  if(!read_instance_cache(&param,stdin,&tspdata,&vdata)){
+    if(param.fastread==0 || !read_tspfile_mmap(stdin,&tspdata,&vdata))
+      read_tspfile(stdin,&tspdata,&vdata);
+    note_instance_source(stdin,&tspdata,&vdata);
+  }
   if(param.givesol==1) read_tourfile(stdin,&tspdata,vdata.bestsol);
   vdata.starttime = cpu_time();
 
@@ -658,7 +6163,9 @@ int main(int argc, char *argv[]){
 
   *****/
 
+  renumber_nodes(&param,&tspdata,&vdata);
   genetic_algorithm(&param,&tspdata,&vdata);
+  restore_numbering(&tspdata,&vdata);
 
   vdata.endtime = cpu_time();
   recompute_obj(&param,&tspdata,&vdata);